@@ -0,0 +1,517 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boolalg/cover.hpp"
+#include "boolalg/dag.hpp"
+
+// Reduced ordered binary decision diagrams. Every function has exactly one BDD for a given
+// variable order, so equivalence is comparing two node indices, and functions whose sum of
+// products explodes (parity, adders, ...) often stay small.
+//
+// Variables are the ones of an ExprPool, identified by their pool index.
+
+typedef uint32_t BddRef;
+
+constexpr BddRef BDD_FALSE = 0;
+constexpr BddRef BDD_TRUE = 1;
+
+class BddManager;
+
+// A counted reference to a BDD node; the node and everything below it stay alive while a
+// handle refers to it. Handles must not outlive their manager.
+class Bdd {
+public:
+    Bdd() = default;
+    Bdd(BddManager *mgr, BddRef id);
+    Bdd(const Bdd &rhs) : Bdd(rhs.mgr, rhs.id) {}
+    Bdd(Bdd &&rhs) noexcept : mgr(rhs.mgr), id(rhs.id) { rhs.mgr = nullptr; }
+    ~Bdd();
+
+    Bdd &operator=(Bdd rhs) noexcept {
+        std::swap(mgr, rhs.mgr);
+        std::swap(id, rhs.id);
+        return *this;
+    }
+
+    [[nodiscard]] BddRef node() const { return id; }
+    [[nodiscard]] BddManager *manager() const { return mgr; }
+
+    [[nodiscard]] bool is_false() const { return id == BDD_FALSE; }
+    [[nodiscard]] bool is_true() const { return id == BDD_TRUE; }
+
+    // same function; O(1) thanks to canonicity
+    bool operator==(const Bdd &rhs) const { return id == rhs.id && mgr == rhs.mgr; }
+    bool operator!=(const Bdd &rhs) const { return !(*this == rhs); }
+
+    Bdd operator~() const;
+    Bdd operator&(const Bdd &rhs) const;
+    Bdd operator|(const Bdd &rhs) const;
+    Bdd operator^(const Bdd &rhs) const;
+
+private:
+    BddManager *mgr = nullptr;
+    BddRef id = BDD_FALSE;
+};
+
+class BddManager {
+public:
+    BddManager() {
+        nodes.push_back({TERMINAL, BDD_FALSE, BDD_FALSE, 1, NONE});
+        nodes.push_back({TERMINAL, BDD_TRUE, BDD_TRUE, 1, NONE});
+        cache.resize(MIN_CACHE);
+    }
+
+    BddManager(const BddManager &) = delete;
+    BddManager &operator=(const BddManager &) = delete;
+
+    [[nodiscard]] Bdd constant(bool value) { return {this, value ? BDD_TRUE : BDD_FALSE}; }
+
+    // the function `var`, or its complement; new variables go below all existing ones
+    Bdd literal(uint32_t var, bool negated = false) {
+        ensure_vars(var + 1);
+        return {this, negated ? mk(var, BDD_TRUE, BDD_FALSE) : mk(var, BDD_FALSE, BDD_TRUE)};
+    }
+
+    Bdd ite(const Bdd &f, const Bdd &g, const Bdd &h) {
+        collect_if_worth_it();
+        return {this, ite(f.node(), g.node(), h.node())};
+    }
+
+    Bdd negate(const Bdd &f) { return ite(f, constant(false), constant(true)); }
+    Bdd conj(const Bdd &f, const Bdd &g) { return ite(f, g, constant(false)); }
+    Bdd disj(const Bdd &f, const Bdd &g) { return ite(f, constant(true), g); }
+    Bdd exclusive(const Bdd &f, const Bdd &g) { return ite(f, negate(g), g); }
+
+    // the BDD of a pool node
+    Bdd from_expr(const ExprPool &pool, BoolNodeId root) {
+        ensure_vars(pool.var_count());
+        std::unordered_map<BoolNodeId, Bdd> seen;
+        return from_expr(pool, root, seen);
+    }
+
+    // Back to an expression, as nested if-then-else on the variables: x * f1 + !x * f0,
+    // shortened where a branch is constant. Shared BDD nodes become shared pool nodes.
+    BoolNodeId to_expr(ExprPool &pool, const Bdd &f) {
+        std::unordered_map<BddRef, BoolNodeId> seen;
+        return to_expr(pool, f.node(), seen);
+    }
+
+    // one cube per path to TRUE; the cubes are pairwise disjoint
+    Cover paths(const Bdd &f) {
+        Cover ret{vars()};
+        std::vector<Lit> path;
+        paths(f.node(), path, ret);
+        return ret;
+    }
+
+    // nodes reachable from f, terminals included
+    std::size_t size(const Bdd &f) const {
+        std::vector<bool> seen(nodes.size());
+        std::vector<BddRef> stack{f.node()};
+        std::size_t ret = 0;
+        while (!stack.empty()) {
+            BddRef n = stack.back();
+            stack.pop_back();
+            if (seen[n])
+                continue;
+            seen[n] = true;
+            ret++;
+            if (n > BDD_TRUE) {
+                stack.push_back(nodes[n].lo);
+                stack.push_back(nodes[n].hi);
+            }
+        }
+        return ret;
+    }
+
+    [[nodiscard]] uint32_t vars() const { return static_cast<uint32_t>(var2level.size()); }
+    [[nodiscard]] std::size_t live_nodes() const { return nodes.size() - free_count; }
+    [[nodiscard]] uint32_t level(uint32_t var) const { return var2level[var]; }
+    [[nodiscard]] uint32_t var_at(uint32_t level) const { return level2var[level]; }
+
+    // Frees every node no handle can reach. Runs by itself between operations whenever the
+    // diagram has doubled since the last collection.
+    void collect() {
+        for (uint32_t l = 0; l < vars(); l++) {
+            Subtable &t = tables[level2var[l]];
+            for (uint32_t &head: t.buckets)
+                for (uint32_t *link = &head; *link != NONE;) {
+                    BddRef n = *link;
+                    if (nodes[n].ref == 0) {
+                        *link = nodes[n].next;
+                        t.count--;
+                        deref(nodes[n].lo);// below this level, so collected later in this pass
+                        deref(nodes[n].hi);
+                        release(n);
+                    } else {
+                        link = &nodes[n].next;
+                    }
+                }
+        }
+        gc_threshold = std::max(MIN_COLLECT, 2 * live_nodes());
+        clear_cache();
+    }
+
+    // Rudell's sifting: each variable in turn, largest level first, is moved through every
+    // position by swapping adjacent levels and left where the diagram was smallest. A
+    // direction is abandoned once the diagram grows past max_growth times its best size.
+    void reorder(double max_growth = 1.2) {
+        collect();
+
+        std::vector<uint32_t> order(vars());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return tables[a].count > tables[b].count; });
+
+        for (uint32_t var: order) {
+            std::size_t best = live_nodes();
+            uint32_t best_level = var2level[var];
+            uint32_t start = best_level;
+
+            auto limit = [&] { return live_nodes() > static_cast<std::size_t>(static_cast<double>(best) * max_growth); };
+            auto track = [&] {
+                if (live_nodes() < best) {
+                    best = live_nodes();
+                    best_level = var2level[var];
+                }
+            };
+
+            // the nearer end first, so the way back is shorter
+            bool down_first = vars() - 1 - start < start;
+            for (int pass = 0; pass < 2; pass++) {
+                if ((pass == 0) == down_first) {
+                    while (var2level[var] + 1 < vars() && !limit()) {
+                        swap_levels(var2level[var]);
+                        track();
+                    }
+                } else {
+                    while (var2level[var] > 0 && !limit()) {
+                        swap_levels(var2level[var] - 1);
+                        track();
+                    }
+                }
+            }
+
+            while (var2level[var] < best_level)
+                swap_levels(var2level[var]);
+            while (var2level[var] > best_level)
+                swap_levels(var2level[var] - 1);
+        }
+
+        clear_cache();
+    }
+
+private:
+    friend class Bdd;
+
+    constexpr static uint32_t NONE = UINT32_MAX;
+    constexpr static uint32_t TERMINAL = UINT32_MAX;// var of the two terminals
+    constexpr static std::size_t MIN_CACHE = std::size_t{1} << 14;
+    constexpr static std::size_t MIN_COLLECT = std::size_t{1} << 14;
+
+    struct BddNode {
+        uint32_t var;
+        BddRef lo, hi;// var = 0 and var = 1
+        uint32_t ref; // parents plus handles; 0 is dead but not yet collected
+        uint32_t next;// unique table chain, or free list
+    };
+
+    // the unique table of one variable, chained through BddNode::next
+    struct Subtable {
+        std::vector<uint32_t> buckets = std::vector<uint32_t>(16, NONE);
+        std::size_t count = 0;
+    };
+
+    struct CacheEntry {
+        BddRef f = NONE, g = NONE, h = NONE, r = NONE;
+    };
+
+    std::vector<BddNode> nodes;
+    std::vector<Subtable> tables;// by variable
+    std::vector<uint32_t> var2level, level2var;
+    std::vector<CacheEntry> cache;// ITE results, direct mapped
+
+    uint32_t free_list = NONE;
+    std::size_t free_count = 0;
+    std::size_t gc_threshold = MIN_COLLECT;
+
+    void ensure_vars(uint32_t count) {
+        for (uint32_t var = vars(); var < count; var++) {
+            var2level.push_back(var);
+            level2var.push_back(var);
+            tables.emplace_back();
+        }
+    }
+
+    [[nodiscard]] uint32_t node_level(BddRef n) const {
+        return nodes[n].var == TERMINAL ? UINT32_MAX : var2level[nodes[n].var];
+    }
+
+    void ref(BddRef n) { nodes[n].ref++; }
+
+    // dead nodes keep their children referenced until collect()
+    void deref(BddRef n) { nodes[n].ref--; }
+
+    void release(BddRef n) {
+        nodes[n].var = TERMINAL;
+        nodes[n].next = free_list;
+        free_list = n;
+        free_count++;
+    }
+
+    static std::size_t hash(BddRef lo, BddRef hi) {
+        return static_cast<std::size_t>(boolalg_detail::hash_mix(lo, hi));
+    }
+
+    void insert(Subtable &t, BddRef n) {
+        if (t.count >= t.buckets.size()) {
+            std::vector<uint32_t> old(t.buckets.size() * 2, NONE);
+            std::swap(old, t.buckets);
+            for (uint32_t head: old)
+                for (uint32_t m = head; m != NONE;) {
+                    uint32_t next = nodes[m].next;
+                    std::size_t b = hash(nodes[m].lo, nodes[m].hi) & (t.buckets.size() - 1);
+                    nodes[m].next = t.buckets[b];
+                    t.buckets[b] = m;
+                    m = next;
+                }
+        }
+
+        std::size_t b = hash(nodes[n].lo, nodes[n].hi) & (t.buckets.size() - 1);
+        nodes[n].next = t.buckets[b];
+        t.buckets[b] = n;
+        t.count++;
+    }
+
+    void erase(Subtable &t, BddRef n) {
+        std::size_t b = hash(nodes[n].lo, nodes[n].hi) & (t.buckets.size() - 1);
+        for (uint32_t *link = &t.buckets[b]; *link != NONE; link = &nodes[*link].next)
+            if (*link == n) {
+                *link = nodes[n].next;
+                t.count--;
+                return;
+            }
+    }
+
+    // the unique node (var, lo, hi); a new node starts out dead
+    BddRef mk(uint32_t var, BddRef lo, BddRef hi) {
+        if (lo == hi)
+            return lo;
+
+        Subtable &t = tables[var];
+        for (uint32_t n = t.buckets[hash(lo, hi) & (t.buckets.size() - 1)]; n != NONE; n = nodes[n].next)
+            if (nodes[n].lo == lo && nodes[n].hi == hi)
+                return n;
+
+        BddRef n;
+        if (free_list != NONE) {
+            n = free_list;
+            free_list = nodes[n].next;
+            free_count--;
+            nodes[n] = {var, lo, hi, 0, NONE};
+        } else {
+            n = static_cast<BddRef>(nodes.size());
+            nodes.push_back({var, lo, hi, 0, NONE});
+            if (nodes.size() > cache.size() * 4)
+                cache.assign(cache.size() * 2, {});
+        }
+        ref(lo);
+        ref(hi);
+        insert(t, n);
+        return n;
+    }
+
+    void collect_if_worth_it() {
+        if (live_nodes() >= gc_threshold)
+            collect();
+    }
+
+    void clear_cache() {
+        std::fill(cache.begin(), cache.end(), CacheEntry{});
+    }
+
+    BddRef ite(BddRef f, BddRef g, BddRef h) {
+        if (f == BDD_TRUE || g == h)
+            return g;
+        if (f == BDD_FALSE)
+            return h;
+        if (g == BDD_TRUE && h == BDD_FALSE)
+            return f;
+
+        CacheEntry &slot = cache[boolalg_detail::hash_mix(boolalg_detail::hash_mix(f, g), h) & (cache.size() - 1)];
+        if (slot.f == f && slot.g == g && slot.h == h)
+            return slot.r;
+
+        uint32_t top = std::min({node_level(f), node_level(g), node_level(h)});
+        uint32_t var = level2var[top];
+        auto low = [&](BddRef x) { return node_level(x) == top ? nodes[x].lo : x; };
+        auto high = [&](BddRef x) { return node_level(x) == top ? nodes[x].hi : x; };
+
+        BddRef t = ite(high(f), high(g), high(h));
+        BddRef e = ite(low(f), low(g), low(h));
+        BddRef r = mk(var, e, t);
+
+        // the recursion may have grown the cache
+        CacheEntry &fresh = cache[boolalg_detail::hash_mix(boolalg_detail::hash_mix(f, g), h) & (cache.size() - 1)];
+        fresh = {f, g, h, r};
+        return r;
+    }
+
+    // Exchanges the variables at levels l and l + 1. Nodes of the upper variable that depend
+    // on the lower one are rewritten in place, so every handle keeps its function.
+    void swap_levels(uint32_t l) {
+        uint32_t x = level2var[l], y = level2var[l + 1];
+        std::swap(level2var[l], level2var[l + 1]);
+        var2level[x] = l + 1;
+        var2level[y] = l;
+
+        std::vector<BddRef> moved;
+        Subtable &tx = tables[x];
+        std::vector<uint32_t> old(tx.buckets.size(), NONE);
+        std::swap(old, tx.buckets);
+        tx.count = 0;
+        for (uint32_t head: old)
+            for (uint32_t n = head; n != NONE;) {
+                uint32_t next = nodes[n].next;
+                if (nodes[nodes[n].lo].var == y || nodes[nodes[n].hi].var == y)
+                    moved.push_back(n);
+                else
+                    insert(tx, n);// independent of y: only its level changes
+                n = next;
+            }
+
+        for (BddRef f: moved) {
+            BddRef f0 = nodes[f].lo, f1 = nodes[f].hi;
+            BddRef f00 = nodes[f0].var == y ? nodes[f0].lo : f0, f01 = nodes[f0].var == y ? nodes[f0].hi : f0;
+            BddRef f10 = nodes[f1].var == y ? nodes[f1].lo : f1, f11 = nodes[f1].var == y ? nodes[f1].hi : f1;
+
+            BddRef lo = mk(x, f00, f10);
+            BddRef hi = mk(x, f01, f11);
+            ref(lo);
+            ref(hi);
+            nodes[f].var = y;
+            nodes[f].lo = lo;
+            nodes[f].hi = hi;
+            insert(tables[y], f);
+            free_if_dead(f0);
+            free_if_dead(f1);
+        }
+    }
+
+    // drops a reference and frees the node at once if that was the last one
+    void free_if_dead(BddRef n) {
+        if (--nodes[n].ref != 0 || n <= BDD_TRUE)
+            return;
+        erase(tables[nodes[n].var], n);
+        free_if_dead(nodes[n].lo);
+        free_if_dead(nodes[n].hi);
+        release(n);
+    }
+
+    Bdd from_expr(const ExprPool &pool, BoolNodeId id, std::unordered_map<BoolNodeId, Bdd> &seen) {
+        auto it = seen.find(id);
+        if (it != seen.end())
+            return it->second;
+
+        const BoolNode &n = pool[id];
+        Bdd ret;
+        switch (n.kind) {
+            case BoolNodeKind::CONST:
+                ret = constant(n.arg != 0);
+                break;
+            case BoolNodeKind::LIT:
+                ret = literal(lit_var(n.arg), lit_negated(n.arg));
+                break;
+            case BoolNodeKind::NOT:
+                ret = negate(from_expr(pool, n.arg, seen));
+                break;
+            case BoolNodeKind::AND:
+            case BoolNodeKind::OR: {
+                ret = constant(n.kind == BoolNodeKind::AND);
+                for (BoolNodeId op: pool.operands(id)) {
+                    Bdd rhs = from_expr(pool, op, seen);
+                    ret = n.kind == BoolNodeKind::AND ? conj(ret, rhs) : disj(ret, rhs);
+                }
+                break;
+            }
+        }
+
+        seen.emplace(id, ret);
+        return ret;
+    }
+
+    BoolNodeId to_expr(ExprPool &pool, BddRef f, std::unordered_map<BddRef, BoolNodeId> &seen) {
+        if (f <= BDD_TRUE)
+            return pool.constant(f == BDD_TRUE);
+
+        auto it = seen.find(f);
+        if (it != seen.end())
+            return it->second;
+
+        uint32_t var = nodes[f].var;
+        BoolNodeId x = pool.literal(make_lit(var, false)), nx = pool.literal(make_lit(var, true));
+        BoolNodeId lo = to_expr(pool, nodes[f].lo, seen), hi = to_expr(pool, nodes[f].hi, seen);
+
+        BoolNodeId ret;
+        if (nodes[f].lo == BDD_FALSE)
+            ret = pool.conj(x, hi);
+        else if (nodes[f].hi == BDD_FALSE)
+            ret = pool.conj(nx, lo);
+        else if (nodes[f].hi == BDD_TRUE)
+            ret = pool.disj(x, lo);
+        else if (nodes[f].lo == BDD_TRUE)
+            ret = pool.disj(nx, hi);
+        else
+            ret = pool.disj(pool.conj(x, hi), pool.conj(nx, lo));
+
+        seen.emplace(f, ret);
+        return ret;
+    }
+
+    void paths(BddRef f, std::vector<Lit> &path, Cover &out) {
+        if (f == BDD_FALSE)
+            return;
+        if (f == BDD_TRUE) {
+            uint64_t *cube = out.add();
+            for (Lit lit: path)
+                out.set(cube, lit);
+            return;
+        }
+
+        path.push_back(make_lit(nodes[f].var, true));
+        paths(nodes[f].lo, path, out);
+        path.back() = make_lit(nodes[f].var, false);
+        paths(nodes[f].hi, path, out);
+        path.pop_back();
+    }
+};
+
+inline Bdd::Bdd(BddManager *mgr, BddRef id) : mgr(mgr), id(id) {
+    if (mgr)
+        mgr->ref(id);
+}
+
+inline Bdd::~Bdd() {
+    if (mgr)
+        mgr->deref(id);
+}
+
+inline Bdd Bdd::operator~() const { return mgr->negate(*this); }
+inline Bdd Bdd::operator&(const Bdd &rhs) const { return mgr->conj(*this, rhs); }
+inline Bdd Bdd::operator|(const Bdd &rhs) const { return mgr->disj(*this, rhs); }
+inline Bdd Bdd::operator^(const Bdd &rhs) const { return mgr->exclusive(*this, rhs); }
+
+// A canonical, compact form of expr: its BDD after sifting, written back as nested
+// if-then-else. Equivalent inputs give structurally identical outputs for a given order.
+inline PExpr bdd_simplify(const PExpr &expr) {
+    ExprPool pool;
+    BddManager mgr;
+    Bdd f = mgr.from_expr(pool, pool.from_expr(expr));
+    mgr.reorder();
+    return pool.to_expr(mgr.to_expr(pool, f));
+}
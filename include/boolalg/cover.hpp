@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+typedef uint32_t Lit;// variable * 2 + negated
+
+constexpr Lit make_lit(uint32_t var, bool negated) { return var << 1 | static_cast<Lit>(negated); }
+constexpr uint32_t lit_var(Lit lit) { return lit >> 1; }
+constexpr bool lit_negated(Lit lit) { return lit & 1; }
+
+// A sum of products over a fixed number of variables. Each cube (product term) is a pair of
+// bitsets, `words` words of positive literals followed by `words` words of negative ones, so
+// merging two cubes or testing whether one subsumes another is a handful of word operations.
+// No cubes is FALSE; a cube without literals is TRUE.
+class Cover {
+public:
+    explicit Cover(std::size_t vars) : words(std::max<std::size_t>(1, (vars + 63) / 64)) {}
+
+    [[nodiscard]] std::size_t size() const { return bits.size() / (2 * words); }
+    [[nodiscard]] bool empty() const { return bits.empty(); }
+    [[nodiscard]] std::size_t width() const { return words; }
+
+    [[nodiscard]] const uint64_t *cube(std::size_t i) const { return bits.data() + i * 2 * words; }
+    uint64_t *cube(std::size_t i) { return bits.data() + i * 2 * words; }
+
+    // appends a cube without literals and returns it
+    uint64_t *add() {
+        bits.resize(bits.size() + 2 * words, 0);
+        return cube(size() - 1);
+    }
+
+    void add(const uint64_t *c) { bits.insert(bits.end(), c, c + 2 * words); }
+
+    void set(uint64_t *c, Lit lit) const {
+        c[lit_negated(lit) * words + lit_var(lit) / 64] |= uint64_t{1} << lit_var(lit) % 64;
+    }
+
+    [[nodiscard]] bool has(const uint64_t *c, Lit lit) const {
+        return c[lit_negated(lit) * words + lit_var(lit) / 64] >> lit_var(lit) % 64 & 1;
+    }
+
+    void append(const Cover &rhs) { bits.insert(bits.end(), rhs.bits.begin(), rhs.bits.end()); }
+    void clear() { bits.clear(); }
+    void make_true() { bits.assign(2 * words, 0); }
+
+    [[nodiscard]] bool is_true() const { return size() == 1 && literals(cube(0)) == 0; }
+
+    [[nodiscard]] std::size_t literals(const uint64_t *c) const {
+        std::size_t ret = 0;
+        for (std::size_t w = 0; w < 2 * words; w++)
+            ret += __builtin_popcountll(c[w]);
+        return ret;
+    }
+
+    // whether cube a implies nothing more than cube b, i.e. a's literals are a subset of b's
+    [[nodiscard]] bool subsumes(const uint64_t *a, const uint64_t *b) const {
+        for (std::size_t w = 0; w < 2 * words; w++)
+            if (a[w] & ~b[w])
+                return false;
+        return true;
+    }
+
+    // Absorption: drops every cube that a smaller or equal one subsumes (A*B + A*B*C is A*B),
+    // which also removes duplicates, and turns x + !x into TRUE.
+    void absorb() {
+        std::size_t n = size();
+        std::vector<std::size_t> count(n), order(n);
+        for (std::size_t i = 0; i < n; i++)
+            count[i] = literals(cube(i));
+
+        // by size, and equal cubes next to each other
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            if (count[a] != count[b])
+                return count[a] < count[b];
+            return std::lexicographical_compare(cube(a), cube(a) + 2 * words, cube(b), cube(b) + 2 * words);
+        });
+
+        std::vector<uint64_t> kept;
+        std::size_t smaller = 0;// kept cubes before this offset have fewer literals than the current one
+        std::vector<uint64_t> units(2 * words, 0);// literals that are cubes on their own
+        for (std::size_t k = 0; k < n; k++) {
+            std::size_t i = order[k];
+            const uint64_t *c = cube(i);
+            if (k > 0 && count[order[k - 1]] != count[i])
+                smaller = kept.size();
+            else if (kept.size() > smaller && std::equal(c, c + 2 * words, kept.end() - 2 * words))
+                continue;
+
+            // only a cube with fewer literals can subsume a different one
+            bool absorbed = false;
+            for (std::size_t j = 0; j < smaller && !absorbed; j += 2 * words)
+                absorbed = subsumes(kept.data() + j, c);
+            if (absorbed)
+                continue;
+
+            if (count[i] == 0) {
+                make_true();
+                return;
+            }
+            if (count[i] == 1) {
+                for (std::size_t w = 0; w < words; w++)
+                    if ((c[w] & units[words + w]) || (c[words + w] & units[w])) {
+                        make_true();
+                        return;
+                    }
+                for (std::size_t w = 0; w < 2 * words; w++)
+                    units[w] |= c[w];
+            }
+            kept.insert(kept.end(), c, c + 2 * words);
+        }
+        bits = std::move(kept);
+    }
+
+    // a * b with absorption, or false if that takes more than max_terms cubes
+    static bool product(const Cover &a, const Cover &b, std::size_t max_terms, Cover &out) {
+        std::size_t words = a.words;
+        out.clear();
+
+        for (std::size_t i = 0; i < a.size(); i++)
+            for (std::size_t j = 0; j < b.size(); j++) {
+                const uint64_t *x = a.cube(i), *y = b.cube(j);
+                bool contradiction = false;
+                for (std::size_t w = 0; w < words && !contradiction; w++)
+                    contradiction = ((x[w] | y[w]) & (x[words + w] | y[words + w])) != 0;
+                if (contradiction)
+                    continue;
+
+                uint64_t *c = out.add();
+                for (std::size_t w = 0; w < 2 * words; w++)
+                    c[w] = x[w] | y[w];
+
+                // absorb in batches so that only the surviving cubes count against the budget
+                if (out.size() > 2 * max_terms) {
+                    out.absorb();
+                    if (out.size() > max_terms)
+                        return false;
+                }
+            }
+
+        out.absorb();
+        return out.size() <= max_terms;
+    }
+
+private:
+    std::size_t words;
+    std::vector<uint64_t> bits;
+};
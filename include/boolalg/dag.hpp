@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boolalg.hpp"
+#include "boolalg/cover.hpp"
+
+typedef uint32_t BoolNodeId;
+
+constexpr BoolNodeId NO_BOOL_NODE = UINT32_MAX;
+
+// expand() stops distributing AND over OR where a sum of products would get larger than this
+constexpr std::size_t EXPAND_MAX_TERMS = std::size_t{1} << 16;
+
+enum class BoolNodeKind : uint8_t {
+    CONST,
+    LIT,
+    NOT,
+    AND,
+    OR
+};
+
+// One arena slot. Nodes are immutable once created and are interned, so two ids are equal
+// iff the expressions are structurally equal.
+struct BoolNode {
+    BoolNodeKind kind;
+    uint32_t arg; // CONST: the value, LIT: the literal, NOT: the operand, AND/OR: first edge
+    uint32_t size;// AND/OR: number of operands
+};
+
+namespace boolalg_detail {
+
+inline uint64_t hash_mix(uint64_t h, uint64_t x) {
+    h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h * 0xff51afd7ed558ccdULL;
+}
+
+}// namespace boolalg_detail
+
+// Arena of hash-consed boolean expression nodes. Variables are small integers, interned by
+// name, and AND/OR operands are flattened, sorted and deduplicated on construction, so
+// expressions that only differ in operand order or grouping share one node.
+class ExprPool {
+public:
+    // the operands of an AND/OR node
+    struct Operands {
+        const BoolNodeId *b, *e;
+        [[nodiscard]] const BoolNodeId *begin() const { return b; }
+        [[nodiscard]] const BoolNodeId *end() const { return e; }
+        [[nodiscard]] std::size_t size() const { return e - b; }
+        BoolNodeId operator[](std::size_t i) const { return b[i]; }
+    };
+
+    ExprPool() {
+        table.assign(1024, NO_BOOL_NODE);
+        intern(BoolNodeKind::CONST, 0, nullptr, 0);
+        intern(BoolNodeKind::CONST, 1, nullptr, 0);
+    }
+
+    ExprPool(const ExprPool &) = delete;
+    ExprPool &operator=(const ExprPool &) = delete;
+
+    [[nodiscard]] const BoolNode &operator[](BoolNodeId id) const { return nodes[id]; }
+    [[nodiscard]] std::size_t size() const { return nodes.size(); }
+
+    [[nodiscard]] Operands operands(BoolNodeId id) const {
+        const BoolNode &n = nodes[id];
+        return {edges.data() + n.arg, edges.data() + n.arg + n.size};
+    }
+
+    // variables, interned by name
+    uint32_t variable(std::string_view name) {
+        auto it = var_index.find(std::string{name});
+        if (it != var_index.end())
+            return it->second;
+
+        uint32_t var = static_cast<uint32_t>(names.size());
+        names.emplace_back(name);
+        values.emplace_back();
+        var_index.emplace(names.back(), var);
+        return var;
+    }
+
+    [[nodiscard]] uint32_t var_count() const { return static_cast<uint32_t>(names.size()); }
+    [[nodiscard]] const std::string &var_name(uint32_t var) const { return names[var]; }
+
+    BoolNodeId constant(bool value) { return static_cast<BoolNodeId>(value); }
+    BoolNodeId literal(Lit lit) { return intern(BoolNodeKind::LIT, lit, nullptr, 0); }
+    BoolNodeId var(std::string_view name, bool negated = false) { return literal(make_lit(variable(name), negated)); }
+
+    BoolNodeId negate(BoolNodeId id) {
+        const BoolNode &n = nodes[id];
+        switch (n.kind) {
+            case BoolNodeKind::CONST:
+                return constant(!n.arg);
+            case BoolNodeKind::LIT:
+                return literal(n.arg ^ 1);
+            case BoolNodeKind::NOT:
+                return n.arg;
+            default:
+                return intern(BoolNodeKind::NOT, id, nullptr, 0);
+        }
+    }
+
+    BoolNodeId conj(std::vector<BoolNodeId> ops) { return nary(BoolNodeKind::AND, std::move(ops)); }
+    BoolNodeId disj(std::vector<BoolNodeId> ops) { return nary(BoolNodeKind::OR, std::move(ops)); }
+
+    BoolNodeId conj(BoolNodeId a, BoolNodeId b) { return conj(std::vector<BoolNodeId>{a, b}); }
+    BoolNodeId disj(BoolNodeId a, BoolNodeId b) { return disj(std::vector<BoolNodeId>{a, b}); }
+
+    // Negations pushed down to the variables and AND distributed over OR, down to a sum of
+    // products without duplicate or absorbed terms (A*B + A*B*C is A*B) and with x + !x and
+    // x * !x short-circuited. Where a product would take more than max_terms terms, its
+    // operands are simplified on their own and stay under an AND instead, so the result is
+    // only a pure sum of products if it fits. Repeats until nothing changes; results are
+    // memoized per node, so shared subexpressions are simplified once.
+    BoolNodeId expand(BoolNodeId id, std::size_t max_terms = EXPAND_MAX_TERMS) {
+        if (max_terms != memo_budget) {
+            memo[0].clear();
+            memo[1].clear();
+            memo_budget = max_terms;
+        }
+
+        for (BoolNodeId prev = NO_BOOL_NODE; id != prev;) {
+            prev = id;
+            id = simplify(id, false);
+        }
+        return id;
+    }
+
+    // imports a tree; Value objects are kept so that to_expr() hands the same ones back
+    BoolNodeId from_expr(const PExpr &expr) {
+        std::unordered_map<const Expr *, BoolNodeId> seen;
+        return from_expr(expr, seen);
+    }
+
+    PExpr to_expr(BoolNodeId id) {
+        std::unordered_map<BoolNodeId, PExpr> seen;
+        return to_expr(id, seen);
+    }
+
+    // the Value behind a variable, created on first use
+    const std::shared_ptr<Value> &value(uint32_t var) {
+        if (!values[var]) {
+            values[var] = std::make_shared<Value>();
+            values[var]->name = names[var];
+        }
+        return values[var];
+    }
+
+    std::string to_string(BoolNodeId id) const {
+        const BoolNode &n = nodes[id];
+        switch (n.kind) {
+            case BoolNodeKind::CONST:
+                return n.arg ? "TRUE" : "FALSE";
+            case BoolNodeKind::LIT:
+                return (lit_negated(n.arg) ? "!" : "") + names[lit_var(n.arg)];
+            case BoolNodeKind::NOT:
+                return "!(" + to_string(n.arg) + ")";
+            default: {
+                std::string ret = "(";
+                for (BoolNodeId op: operands(id)) {
+                    if (ret.size() > 1)
+                        ret += n.kind == BoolNodeKind::AND ? " * " : " + ";
+                    ret += to_string(op);
+                }
+                return ret + ")";
+            }
+        }
+    }
+
+    // whether id is a sum of products, as built by build_cover()
+    [[nodiscard]] bool is_cover(BoolNodeId id) const {
+        auto is_cube = [&](BoolNodeId op) {
+            if (nodes[op].kind == BoolNodeKind::LIT)
+                return true;
+            if (nodes[op].kind != BoolNodeKind::AND)
+                return false;
+            for (BoolNodeId lit: operands(op))
+                if (nodes[lit].kind != BoolNodeKind::LIT)
+                    return false;
+            return true;
+        };
+
+        switch (nodes[id].kind) {
+            case BoolNodeKind::CONST:
+                return true;
+            case BoolNodeKind::OR:
+                for (BoolNodeId op: operands(id))
+                    if (!is_cube(op))
+                        return false;
+                return true;
+            default:
+                return is_cube(id);
+        }
+    }
+
+    // appends the cubes of a node for which is_cover() holds
+    void read_cover(BoolNodeId id, Cover &cover) const {
+        const BoolNode &n = nodes[id];
+        if (n.kind == BoolNodeKind::CONST) {
+            if (n.arg)
+                cover.add();
+        } else if (n.kind == BoolNodeKind::OR) {
+            for (BoolNodeId op: operands(id))
+                read_cube(op, cover, cover.add());
+        } else {
+            read_cube(id, cover, cover.add());
+        }
+    }
+
+    // the sum of products of a cover over this pool's variables
+    BoolNodeId build_cover(const Cover &cover) {
+        std::vector<BoolNodeId> terms;
+        terms.reserve(cover.size());
+        for (std::size_t i = 0; i < cover.size(); i++) {
+            const uint64_t *cube = cover.cube(i);
+            std::vector<BoolNodeId> lits;
+            for (std::size_t w = 0; w < 2 * cover.width(); w++)
+                for (uint64_t bits = cube[w]; bits; bits &= bits - 1) {
+                    uint32_t var = static_cast<uint32_t>(w % cover.width() * 64 + __builtin_ctzll(bits));
+                    lits.push_back(literal(make_lit(var, w >= cover.width())));
+                }
+            terms.push_back(conj(std::move(lits)));
+        }
+        return disj(std::move(terms));
+    }
+
+private:
+    std::vector<BoolNode> nodes;
+    std::vector<uint64_t> hashes;
+    std::vector<BoolNodeId> edges;
+    std::vector<BoolNodeId> table;// open addressing, at most half full
+
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<Value>> values;
+    std::unordered_map<std::string, uint32_t> var_index;
+
+    std::vector<BoolNodeId> memo[2];// simplify() of each node, and of its negation
+    std::size_t memo_budget = 0;
+
+    static uint64_t hash_of(BoolNodeKind kind, uint32_t arg, const BoolNodeId *ops, uint32_t size) {
+        uint64_t h = boolalg_detail::hash_mix(static_cast<uint64_t>(kind), size ? size : arg);
+        for (uint32_t i = 0; i < size; i++)
+            h = boolalg_detail::hash_mix(h, ops[i]);
+        return h;
+    }
+
+    bool same(BoolNodeId id, BoolNodeKind kind, uint32_t arg, const BoolNodeId *ops, uint32_t size) const {
+        const BoolNode &n = nodes[id];
+        if (n.kind != kind)
+            return false;
+        if (kind != BoolNodeKind::AND && kind != BoolNodeKind::OR)
+            return n.arg == arg;
+        return n.size == size && std::equal(ops, ops + size, edges.data() + n.arg);
+    }
+
+    BoolNodeId intern(BoolNodeKind kind, uint32_t arg, const BoolNodeId *ops, uint32_t size) {
+        uint64_t h = hash_of(kind, arg, ops, size);
+        std::size_t mask = table.size() - 1;
+        std::size_t slot = h & mask;
+        for (; table[slot] != NO_BOOL_NODE; slot = (slot + 1) & mask)
+            if (hashes[table[slot]] == h && same(table[slot], kind, arg, ops, size))
+                return table[slot];
+
+        BoolNodeId id = static_cast<BoolNodeId>(nodes.size());
+        if (size > 0) {
+            arg = static_cast<uint32_t>(edges.size());
+            edges.insert(edges.end(), ops, ops + size);
+        }
+        nodes.push_back({kind, arg, size});
+        hashes.push_back(h);
+        table[slot] = id;
+
+        if (nodes.size() * 2 > table.size())
+            rehash();
+        return id;
+    }
+
+    void rehash() {
+        table.assign(table.size() * 2, NO_BOOL_NODE);
+        std::size_t mask = table.size() - 1;
+        for (BoolNodeId id = 0; id < nodes.size(); id++) {
+            std::size_t slot = hashes[id] & mask;
+            while (table[slot] != NO_BOOL_NODE)
+                slot = (slot + 1) & mask;
+            table[slot] = id;
+        }
+    }
+
+    // flattens, folds constants, sorts and deduplicates before interning
+    BoolNodeId nary(BoolNodeKind kind, std::vector<BoolNodeId> ops) {
+        bool absorbing = kind == BoolNodeKind::OR;// TRUE absorbs an OR, FALSE an AND
+
+        std::vector<BoolNodeId> flat;
+        flat.reserve(ops.size());
+        for (BoolNodeId op: ops) {
+            if (nodes[op].kind == kind) {
+                Operands inner = operands(op);
+                flat.insert(flat.end(), inner.begin(), inner.end());
+            } else if (nodes[op].kind == BoolNodeKind::CONST) {
+                if (nodes[op].arg == static_cast<uint32_t>(absorbing))
+                    return constant(absorbing);
+            } else {
+                flat.push_back(op);
+            }
+        }
+
+        std::sort(flat.begin(), flat.end());
+        flat.erase(std::unique(flat.begin(), flat.end()), flat.end());
+        if (flat.empty())
+            return constant(!absorbing);
+        if (flat.size() == 1)
+            return flat[0];
+        return intern(kind, 0, flat.data(), static_cast<uint32_t>(flat.size()));
+    }
+
+    void read_cube(BoolNodeId id, Cover &cover, uint64_t *cube) const {
+        if (nodes[id].kind == BoolNodeKind::LIT)
+            cover.set(cube, nodes[id].arg);
+        else
+            for (BoolNodeId lit: operands(id))
+                cover.set(cube, nodes[lit].arg);
+    }
+
+    // One bottom-up pass of expand() over id, or over its negation. Operands that came out as
+    // sums of products are combined as bitset covers; the others are kept as they are.
+    BoolNodeId simplify(BoolNodeId id, bool negated) {
+        if (memo[negated].size() <= id)
+            memo[negated].resize(nodes.size(), NO_BOOL_NODE);
+        if (memo[negated][id] != NO_BOOL_NODE)
+            return memo[negated][id];
+
+        const BoolNode n = nodes[id];
+        BoolNodeId ret;
+        switch (n.kind) {
+            case BoolNodeKind::CONST:
+                ret = constant(n.arg != static_cast<uint32_t>(negated));
+                break;
+            case BoolNodeKind::LIT:
+                ret = literal(n.arg ^ static_cast<Lit>(negated));
+                break;
+            case BoolNodeKind::NOT:
+                ret = simplify(n.arg, !negated);
+                break;
+            default: {
+                std::vector<BoolNodeId> ops;
+                for (uint32_t i = 0; i < n.size; i++)
+                    ops.push_back(simplify(edges[n.arg + i], negated));
+
+                // De Morgan: a negated AND is an OR of negations and vice versa
+                if ((n.kind == BoolNodeKind::AND) != negated)
+                    ret = simplify_product(ops);
+                else
+                    ret = simplify_sum(ops);
+                break;
+            }
+        }
+
+        memo[0].resize(nodes.size(), NO_BOOL_NODE);
+        memo[1].resize(nodes.size(), NO_BOOL_NODE);
+        memo[negated][id] = ret;
+        memo[false][ret] = ret;// a pass changes nothing in its own output
+        return ret;
+    }
+
+    BoolNodeId simplify_sum(const std::vector<BoolNodeId> &ops) {
+        Cover sum{var_count()};
+        std::vector<BoolNodeId> rest;
+        for (BoolNodeId op: ops) {
+            if (is_cover(op))
+                read_cover(op, sum);
+            else
+                rest.push_back(op);
+        }
+
+        sum.absorb();
+        rest.push_back(build_cover(sum));
+        return disj(std::move(rest));
+    }
+
+    // Multiplies the covers out while they stay within the budget. A product that would
+    // exceed it closes the current group, and the groups end up under an AND.
+    BoolNodeId simplify_product(const std::vector<BoolNodeId> &ops) {
+        Cover acc{var_count()}, next{var_count()}, out{var_count()};
+        acc.make_true();
+
+        std::vector<BoolNodeId> rest;
+        for (BoolNodeId op: ops) {
+            if (!is_cover(op)) {
+                rest.push_back(op);
+                continue;
+            }
+
+            next.clear();
+            read_cover(op, next);
+            if (Cover::product(acc, next, memo_budget, out)) {
+                std::swap(acc, out);
+                if (acc.empty())
+                    return constant(false);
+            } else {
+                rest.push_back(build_cover(acc));
+                std::swap(acc, next);
+            }
+        }
+
+        rest.push_back(build_cover(acc));
+        return conj(std::move(rest));
+    }
+
+    BoolNodeId from_expr(const PExpr &expr, std::unordered_map<const Expr *, BoolNodeId> &seen) {
+        auto it = seen.find(expr.get());
+        if (it != seen.end())
+            return it->second;
+
+        BoolNodeId ret;
+        if (auto c = std::dynamic_pointer_cast<Constant>(expr)) {
+            ret = constant(c->value);
+        } else if (auto v = std::dynamic_pointer_cast<Variable>(expr)) {
+            uint32_t var = variable(v->value->name);
+            if (!values[var])
+                values[var] = v->value;
+            ret = literal(make_lit(var, v->inv));
+        } else if (auto n = std::dynamic_pointer_cast<Not>(expr)) {
+            ret = negate(from_expr(n->next, seen));
+        } else if (auto a = std::dynamic_pointer_cast<And>(expr)) {
+            std::vector<BoolNodeId> ops;
+            for (const PExpr &child: a->children)
+                ops.push_back(from_expr(child, seen));
+            ret = conj(std::move(ops));
+        } else if (auto o = std::dynamic_pointer_cast<Or>(expr)) {
+            std::vector<BoolNodeId> ops;
+            for (const PExpr &child: o->children)
+                ops.push_back(from_expr(child, seen));
+            ret = disj(std::move(ops));
+        } else {
+            throw std::runtime_error{"Unknown expression type"};
+        }
+
+        seen.emplace(expr.get(), ret);
+        return ret;
+    }
+
+    PExpr to_expr(BoolNodeId id, std::unordered_map<BoolNodeId, PExpr> &seen) {
+        auto it = seen.find(id);
+        if (it != seen.end())
+            return it->second;
+
+        const BoolNode n = nodes[id];
+        PExpr ret;
+        switch (n.kind) {
+            case BoolNodeKind::CONST:
+                ret = std::make_shared<Constant>(n.arg != 0);
+                break;
+            case BoolNodeKind::LIT: {
+                auto v = std::make_shared<Variable>();
+                v->value = value(lit_var(n.arg));
+                v->inv = lit_negated(n.arg);
+                ret = v;
+                break;
+            }
+            case BoolNodeKind::NOT:
+                ret = std::make_shared<Not>(to_expr(n.arg, seen));
+                break;
+            case BoolNodeKind::AND:
+            case BoolNodeKind::OR: {
+                std::vector<PExpr> children;
+                children.reserve(n.size);
+                for (uint32_t i = 0; i < n.size; i++)
+                    children.push_back(to_expr(edges[n.arg + i], seen));
+                if (n.kind == BoolNodeKind::AND)
+                    ret = std::make_shared<And>(std::move(children));
+                else
+                    ret = std::make_shared<Or>(std::move(children));
+                break;
+            }
+        }
+
+        seen.emplace(id, ret);
+        return ret;
+    }
+};
+
+// Sum-of-products form of expr, as far as max_terms allows (see ExprPool::expand()).
+inline PExpr expand(const PExpr &expr, std::size_t max_terms = EXPAND_MAX_TERMS) {
+    ExprPool pool;
+    return pool.to_expr(pool.expand(pool.from_expr(expr), max_terms));
+}
+
+// expand() already reaches a fixpoint; n is kept for existing callers
+inline PExpr full_expand(const PExpr &expr, int n = 1) {
+    (void) n;
+    return expand(expr);
+}
@@ -0,0 +1,518 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boolalg/cover.hpp"
+#include "boolalg/dag.hpp"
+
+// Two-level minimization: the same function as a sum of products with as few cubes, and then
+// as few literals, as possible. Up to QM_MAX_VARS variables Quine-McCluskey gives an exact
+// minimum; above that an Espresso-style expand / irredundant / reduce loop gets close to one.
+
+constexpr uint32_t QM_MAX_VARS = 12;
+
+// branch-and-bound steps the exact cover selection takes before settling for its best so far
+constexpr std::size_t QM_MAX_BRANCHES = std::size_t{1} << 16;
+
+namespace boolalg_detail {
+
+// the variables a cover mentions
+inline std::vector<uint32_t> cover_support(const Cover &f) {
+    std::size_t words = f.width();
+    std::vector<uint64_t> used(words, 0);
+    for (std::size_t i = 0; i < f.size(); i++)
+        for (std::size_t w = 0; w < words; w++)
+            used[w] |= f.cube(i)[w] | f.cube(i)[words + w];
+
+    std::vector<uint32_t> ret;
+    for (std::size_t w = 0; w < words; w++)
+        for (uint64_t bits = used[w]; bits; bits &= bits - 1)
+            ret.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits)));
+    return ret;
+}
+
+// Quine-McCluskey over the at most QM_MAX_VARS variables in vars. An implicant is a pair of
+// bitsets over positions in vars: `mask` has the eliminated variables and `val` the values of
+// the others, so merging two implicants and enumerating minterms are plain integer operations.
+class QuineMcCluskey {
+public:
+    QuineMcCluskey(const Cover &f, const std::vector<uint32_t> &vars) : f(f), vars(vars), k(static_cast<uint32_t>(vars.size())) {}
+
+    Cover run() {
+        minterms();
+        primes();
+        chart();
+
+        std::vector<uint64_t> uncovered(row_words, 0);
+        for (std::size_t m = 0; m < rows.size(); m++)
+            uncovered[m / 64] |= uint64_t{1} << m % 64;
+        search(uncovered, 0);
+
+        Cover ret{f.width() * 64};
+        for (uint32_t p: best) {
+            uint64_t *cube = ret.add();
+            for (uint32_t j = 0; j < k; j++)
+                if (!(implicants[p].mask >> j & 1))
+                    ret.set(cube, make_lit(vars[j], !(implicants[p].val >> j & 1)));
+        }
+        return ret;
+    }
+
+private:
+    struct Implicant {
+        uint32_t val, mask;
+    };
+
+    // cube ordering: fewer cubes first, fewer literals second
+    constexpr static uint64_t CUBE_COST = uint64_t{1} << 32;
+
+    const Cover &f;
+    const std::vector<uint32_t> &vars;
+    uint32_t k;
+
+    std::vector<uint64_t> on;// one bit per minterm
+    std::vector<uint32_t> rows;// the minterms, in order
+    std::vector<Implicant> implicants;// the primes
+
+    std::size_t row_words = 0;
+    std::vector<std::vector<uint64_t>> cols;// per prime, the rows it covers
+    std::vector<std::vector<uint32_t>> covering;// per row, the primes that cover it
+    std::vector<uint32_t> cost;// literals per prime
+    std::size_t largest = 1;// rows of the largest prime
+
+    std::vector<uint32_t> chosen, best;
+    uint64_t best_cost = UINT64_MAX;
+    std::size_t branches = 0;
+
+    static std::size_t words_for(std::size_t bits) { return (bits + 63) / 64; }
+    static bool test(const std::vector<uint64_t> &set, std::size_t i) { return set[i / 64] >> i % 64 & 1; }
+    static void mark(std::vector<uint64_t> &set, std::size_t i) { set[i / 64] |= uint64_t{1} << i % 64; }
+
+    // calls visit with every minterm of the implicant
+    template<typename F>
+    static void each_minterm(Implicant imp, F &&visit) {
+        uint32_t s = 0;
+        do {
+            visit(imp.val | s);
+            s = (s - imp.mask) & imp.mask;
+        } while (s != 0);
+    }
+
+    void minterms() {
+        on.assign(words_for(std::size_t{1} << k), 0);
+        for (std::size_t i = 0; i < f.size(); i++) {
+            Implicant imp{0, (uint32_t{1} << k) - 1};
+            for (uint32_t j = 0; j < k; j++) {
+                if (f.has(f.cube(i), make_lit(vars[j], false))) {
+                    imp.val |= uint32_t{1} << j;
+                    imp.mask &= ~(uint32_t{1} << j);
+                } else if (f.has(f.cube(i), make_lit(vars[j], true))) {
+                    imp.mask &= ~(uint32_t{1} << j);
+                }
+            }
+            each_minterm(imp, [&](uint32_t m) { mark(on, m); });
+        }
+
+        for (uint32_t m = 0; m < uint32_t{1} << k; m++)
+            if (test(on, m))
+                rows.push_back(m);
+    }
+
+    // Merges implicants that differ in one variable, one mask at a time. Every subset of a
+    // mask is numerically smaller, so its implicants are complete by the time it is reached.
+    void primes() {
+        std::size_t points = std::size_t{1} << k, words = words_for(points);
+        std::vector<std::vector<uint64_t>> present(points);
+        present[0] = on;
+
+        for (uint32_t mask = 0; mask < points; mask++) {
+            if (present[mask].empty())
+                continue;
+
+            std::vector<uint64_t> merged(words, 0);
+            for (std::size_t w = 0; w < words; w++)
+                for (uint64_t bits = present[mask][w]; bits; bits &= bits - 1) {
+                    uint32_t val = static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits));
+                    for (uint32_t j = 0; j < k; j++) {
+                        uint32_t bit = uint32_t{1} << j;
+                        if ((mask | val) & bit || !test(present[mask], val | bit))
+                            continue;
+                        if (present[mask | bit].empty())
+                            present[mask | bit].assign(words, 0);
+                        mark(present[mask | bit], val);
+                        mark(merged, val);
+                        mark(merged, val | bit);
+                    }
+                }
+
+            for (std::size_t w = 0; w < words; w++)
+                for (uint64_t bits = present[mask][w] & ~merged[w]; bits; bits &= bits - 1)
+                    implicants.push_back({static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits)), mask});
+            present[mask] = {};
+        }
+    }
+
+    void chart() {
+        std::vector<uint32_t> row_of(std::size_t{1} << k);
+        for (uint32_t r = 0; r < rows.size(); r++)
+            row_of[rows[r]] = r;
+
+        row_words = words_for(rows.size());
+        covering.resize(rows.size());
+        for (uint32_t p = 0; p < implicants.size(); p++) {
+            std::vector<uint64_t> col(row_words, 0);
+            std::size_t n = 0;
+            each_minterm(implicants[p], [&](uint32_t m) {
+                mark(col, row_of[m]);
+                covering[row_of[m]].push_back(p);
+                n++;
+            });
+            cols.push_back(std::move(col));
+            cost.push_back(k - static_cast<uint32_t>(__builtin_popcount(implicants[p].mask)));
+            largest = std::max(largest, n);
+        }
+    }
+
+    // Branch and bound over the prime implicant chart: the uncovered row with the fewest
+    // primes decides the branches, so essential primes are taken without branching.
+    void search(const std::vector<uint64_t> &uncovered, uint64_t spent) {
+        std::size_t pick = SIZE_MAX, left = 0;
+        for (std::size_t w = 0; w < row_words; w++)
+            for (uint64_t bits = uncovered[w]; bits; bits &= bits - 1) {
+                std::size_t r = w * 64 + __builtin_ctzll(bits);
+                if (pick == SIZE_MAX || covering[r].size() < covering[pick].size())
+                    pick = r;
+                left++;
+            }
+
+        if (pick == SIZE_MAX) {
+            if (spent < best_cost) {
+                best_cost = spent;
+                best = chosen;
+            }
+            return;
+        }
+
+        // every further cube covers at most `largest` rows
+        uint64_t bound = spent + (left + largest - 1) / largest * CUBE_COST;
+        if (bound >= best_cost || (++branches > QM_MAX_BRANCHES && !best.empty()))
+            return;
+
+        // what each candidate would still cover; a candidate another one covers more for no
+        // more literals is never needed
+        std::vector<uint32_t> &cands = covering[pick];
+        std::vector<std::vector<uint64_t>> gain(cands.size(), std::vector<uint64_t>(row_words));
+        std::vector<std::size_t> count(cands.size(), 0);
+        for (std::size_t i = 0; i < cands.size(); i++)
+            for (std::size_t w = 0; w < row_words; w++) {
+                gain[i][w] = cols[cands[i]][w] & uncovered[w];
+                count[i] += __builtin_popcountll(gain[i][w]);
+            }
+
+        auto dominates = [&](std::size_t a, std::size_t b) {
+            if (cost[cands[a]] > cost[cands[b]])
+                return false;
+            for (std::size_t w = 0; w < row_words; w++)
+                if (gain[b][w] & ~gain[a][w])
+                    return false;
+            return count[a] > count[b] || cost[cands[a]] < cost[cands[b]] || a < b;
+        };
+
+        std::vector<std::size_t> order;
+        for (std::size_t i = 0; i < cands.size(); i++) {
+            bool dominated = false;
+            for (std::size_t j = 0; j < cands.size() && !dominated; j++)
+                dominated = j != i && dominates(j, i);
+            if (!dominated)
+                order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return count[a] > count[b]; });
+
+        std::vector<uint64_t> next(row_words);
+        for (std::size_t i: order) {
+            for (std::size_t w = 0; w < row_words; w++)
+                next[w] = uncovered[w] & ~gain[i][w];
+            chosen.push_back(cands[i]);
+            search(next, spent + CUBE_COST + cost[cands[i]]);
+            chosen.pop_back();
+        }
+    }
+};
+
+// Espresso's loop without an explicit off-set: whether a cube may grow, or shrink, is decided
+// by checking containment in the rest of the cover with unate recursive tautology.
+class Espresso {
+public:
+    explicit Espresso(Cover f) : f(std::move(f)), words(this->f.width()), support(cover_support(this->f)) {}
+
+    Cover run() {
+        f.absorb();
+        if (f.size() <= 1)
+            return f;
+
+        expand();
+        irredundant();
+        for (;;) {
+            Cover prev = f;
+            auto before = cost(f);
+            reduce();
+            expand();
+            irredundant();
+            if (cost(f) >= before) {
+                if (cost(f) > before)
+                    f = std::move(prev);
+                return f;
+            }
+        }
+    }
+
+private:
+    typedef std::vector<uint64_t> Cube;
+
+    Cover f;
+    std::size_t words;
+    std::vector<uint32_t> support;
+
+    std::pair<std::size_t, std::size_t> cost(const Cover &c) const {
+        std::size_t lits = 0;
+        for (std::size_t i = 0; i < c.size(); i++)
+            lits += c.literals(c.cube(i));
+        return {c.size(), lits};
+    }
+
+    Cube cube(std::size_t i) const { return {f.cube(i), f.cube(i) + 2 * words}; }
+
+    void clear(Cube &c, Lit lit) const {
+        c[lit_negated(lit) * words + lit_var(lit) / 64] &= ~(uint64_t{1} << lit_var(lit) % 64);
+    }
+
+    // the cubes of g that meet c, without c's literals
+    Cover cofactor(const Cover &g, const uint64_t *c) const {
+        Cover ret{words * 64};
+        for (std::size_t i = 0; i < g.size(); i++) {
+            const uint64_t *d = g.cube(i);
+            bool disjoint = false;
+            for (std::size_t w = 0; w < words && !disjoint; w++)
+                disjoint = ((d[w] & c[words + w]) | (d[words + w] & c[w])) != 0;
+            if (disjoint)
+                continue;
+            uint64_t *out = ret.add();
+            for (std::size_t w = 0; w < 2 * words; w++)
+                out[w] = d[w] & ~c[w];
+        }
+        return ret;
+    }
+
+    // Unate recursive paradigm: variables that occur in one polarity only can be set against
+    // it, which leaves the cubes without them; a binate variable is split on.
+    bool tautology(const Cover &g) const {
+        if (g.empty())
+            return false;
+
+        Cube pos(words, 0), neg(words, 0);
+        for (std::size_t i = 0; i < g.size(); i++) {
+            const uint64_t *c = g.cube(i);
+            if (g.literals(c) == 0)
+                return true;
+            for (std::size_t w = 0; w < words; w++) {
+                pos[w] |= c[w];
+                neg[w] |= c[words + w];
+            }
+        }
+
+        bool unate = false;
+        for (std::size_t w = 0; w < words; w++)
+            unate = unate || (pos[w] ^ neg[w]) != 0;
+        if (unate) {
+            Cover rest{words * 64};
+            for (std::size_t i = 0; i < g.size(); i++) {
+                const uint64_t *c = g.cube(i);
+                bool keep = true;
+                for (std::size_t w = 0; w < words && keep; w++)
+                    keep = ((c[w] | c[words + w]) & (pos[w] ^ neg[w])) == 0;
+                if (keep)
+                    rest.add(c);
+            }
+            return tautology(rest);
+        }
+
+        // the binate variable in the most cubes
+        std::vector<uint32_t> count(words * 64, 0);
+        for (std::size_t i = 0; i < g.size(); i++)
+            for (std::size_t w = 0; w < words; w++)
+                for (uint64_t bits = g.cube(i)[w] | g.cube(i)[words + w]; bits; bits &= bits - 1)
+                    count[w * 64 + __builtin_ctzll(bits)]++;
+        uint32_t var = static_cast<uint32_t>(std::max_element(count.begin(), count.end()) - count.begin());
+
+        for (bool negated: {false, true}) {
+            Cube lit(2 * words, 0);
+            g.set(lit.data(), make_lit(var, negated));
+            if (!tautology(cofactor(g, lit.data())))
+                return false;
+        }
+        return true;
+    }
+
+    bool contained(const Cube &c, const Cover &g) const { return tautology(cofactor(g, c.data())); }
+
+    Cover without(std::size_t skip, const std::vector<bool> &removed) const {
+        Cover ret{words * 64};
+        for (std::size_t i = 0; i < f.size(); i++)
+            if (i != skip && !removed[i])
+                ret.add(f.cube(i));
+        return ret;
+    }
+
+    void keep(const std::vector<bool> &removed) {
+        Cover ret{words * 64};
+        for (std::size_t i = 0; i < f.size(); i++)
+            if (!removed[i])
+                ret.add(f.cube(i));
+        f = std::move(ret);
+    }
+
+    std::vector<std::size_t> by_literals(bool ascending) const {
+        std::vector<std::size_t> order(f.size());
+        for (std::size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            std::size_t la = f.literals(f.cube(a)), lb = f.literals(f.cube(b));
+            return ascending ? la < lb : la > lb;
+        });
+        return order;
+    }
+
+    // Drops literals from each cube, largest cubes first, as long as the cube stays inside the
+    // function; rare literals go first, as they are the likeliest to keep other cubes out.
+    // Cubes the grown one now contains are dropped.
+    void expand() {
+        std::vector<uint32_t> occurs(2 * words * 64, 0);
+        for (std::size_t i = 0; i < f.size(); i++)
+            for (uint32_t var: support)
+                for (bool negated: {false, true})
+                    occurs[make_lit(var, negated)] += f.has(f.cube(i), make_lit(var, negated));
+
+        std::vector<bool> removed(f.size(), false);
+        for (std::size_t i: by_literals(true)) {
+            if (removed[i])
+                continue;
+
+            std::vector<Lit> lits;
+            for (uint32_t var: support)
+                for (bool negated: {false, true})
+                    if (f.has(f.cube(i), make_lit(var, negated)))
+                        lits.push_back(make_lit(var, negated));
+            std::stable_sort(lits.begin(), lits.end(), [&](Lit a, Lit b) { return occurs[a] < occurs[b]; });
+
+            Cube c = cube(i);
+            for (Lit lit: lits) {
+                Cube grown = c;
+                clear(grown, lit);
+                if (contained(grown, f))
+                    c = std::move(grown);
+            }
+
+            std::copy(c.begin(), c.end(), f.cube(i));
+            for (std::size_t j = 0; j < f.size(); j++)
+                if (j != i && !removed[j] && f.subsumes(f.cube(i), f.cube(j)))
+                    removed[j] = true;
+        }
+        keep(removed);
+    }
+
+    // drops cubes the others cover, smallest cubes first
+    void irredundant() {
+        std::vector<bool> removed(f.size(), false);
+        for (std::size_t i: by_literals(false))
+            if (contained(cube(i), without(i, removed)))
+                removed[i] = true;
+        keep(removed);
+    }
+
+    // Shrinks each cube, largest first, to what the other cubes leave uncovered, so that the
+    // next expand() can grow it in a different direction.
+    void reduce() {
+        std::vector<bool> removed(f.size(), false);
+        for (std::size_t i: by_literals(true)) {
+            Cover rest = without(i, removed);
+            Cube c = cube(i);
+            if (contained(c, rest)) {
+                removed[i] = true;
+                continue;
+            }
+
+            for (uint32_t var: support)
+                for (bool negated: {false, true}) {
+                    if (f.has(c.data(), make_lit(var, false)) || f.has(c.data(), make_lit(var, true)))
+                        break;
+                    Cube dropped = c;
+                    f.set(dropped.data(), make_lit(var, !negated));
+                    if (contained(dropped, rest)) {
+                        f.set(c.data(), make_lit(var, negated));
+                        break;
+                    }
+                }
+
+            std::copy(c.begin(), c.end(), f.cube(i));
+        }
+        keep(removed);
+    }
+};
+
+inline BoolNodeId minimize(ExprPool &pool, BoolNodeId id, std::unordered_map<BoolNodeId, BoolNodeId> &seen);
+
+}// namespace boolalg_detail
+
+// A cover of the same function with a minimum number of cubes and then of literals if it
+// mentions at most QM_MAX_VARS variables, and a near-minimal one otherwise.
+inline Cover minimize(const Cover &f) {
+    std::vector<uint32_t> vars = boolalg_detail::cover_support(f);
+    if (vars.size() <= QM_MAX_VARS)
+        return boolalg_detail::QuineMcCluskey{f, vars}.run();
+    return boolalg_detail::Espresso{f}.run();
+}
+
+// expand()s id and minimizes the sums of products in the result
+inline BoolNodeId minimize(ExprPool &pool, BoolNodeId id, std::size_t max_terms = EXPAND_MAX_TERMS) {
+    std::unordered_map<BoolNodeId, BoolNodeId> seen;
+    return boolalg_detail::minimize(pool, pool.expand(id, max_terms), seen);
+}
+
+inline PExpr minimize(const PExpr &expr, std::size_t max_terms = EXPAND_MAX_TERMS) {
+    ExprPool pool;
+    return pool.to_expr(minimize(pool, pool.from_expr(expr), max_terms));
+}
+
+namespace boolalg_detail {
+
+inline BoolNodeId minimize(ExprPool &pool, BoolNodeId id, std::unordered_map<BoolNodeId, BoolNodeId> &seen) {
+    auto it = seen.find(id);
+    if (it != seen.end())
+        return it->second;
+
+    BoolNodeId ret = id;
+    const BoolNode n = pool[id];
+    if (pool.is_cover(id)) {
+        Cover f{pool.var_count()};
+        pool.read_cover(id, f);
+        ret = pool.build_cover(::minimize(f));
+    } else if (n.kind == BoolNodeKind::NOT) {
+        ret = pool.negate(minimize(pool, n.arg, seen));
+    } else if (n.kind == BoolNodeKind::AND || n.kind == BoolNodeKind::OR) {
+        std::vector<BoolNodeId> ops;
+        for (BoolNodeId op: pool.operands(id))
+            ops.push_back(op);
+        for (BoolNodeId &op: ops)
+            op = minimize(pool, op, seen);
+        ret = n.kind == BoolNodeKind::AND ? pool.conj(std::move(ops)) : pool.disj(std::move(ops));
+    }
+
+    seen.emplace(id, ret);
+    return ret;
+}
+
+}// namespace boolalg_detail
@@ -0,0 +1,610 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "boolalg/cover.hpp"
+#include "boolalg/dag.hpp"
+
+// Satisfiability without expansion: a CDCL solver (two watched literals, VSIDS, first-UIP
+// clause learning, Luby restarts, learnt clause deletion by LBD) and a Tseitin encoding of
+// ExprPool nodes into it. Clause literals use the Lit encoding of cover.hpp.
+
+enum class SatResult : uint8_t {
+    SAT,
+    UNSAT,
+    UNKNOWN// the conflict budget ran out
+};
+
+namespace boolalg_detail {
+
+constexpr uint8_t L_FALSE = 0, L_TRUE = 1, L_UNDEF = 2;
+
+// the i-th element (from 0) of the Luby sequence 1 1 2 1 1 2 4 1 1 2 ...
+inline uint64_t luby(uint64_t i) {
+    uint64_t size = 1, seq = 0;
+    while (size < i + 1) {
+        seq++;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != i) {
+        size = (size - 1) / 2;
+        seq--;
+        i %= size;
+    }
+    return uint64_t{1} << seq;
+}
+
+}// namespace boolalg_detail
+
+class Solver {
+public:
+    // conflicts in the first restart; later ones follow the Luby sequence
+    constexpr static uint64_t RESTART_BASE = 100;
+
+    uint32_t new_var() {
+        uint32_t var = vars();
+        assigns.push_back(boolalg_detail::L_UNDEF);
+        level.push_back(0);
+        reason.push_back(NO_CLAUSE);
+        phase.push_back(true);
+        seen.push_back(false);
+        activity.push_back(0);
+        heap_pos.push_back(NOT_IN_HEAP);
+        watches.emplace_back();
+        watches.emplace_back();
+        heap_insert(var);
+        return var;
+    }
+
+    [[nodiscard]] uint32_t vars() const { return static_cast<uint32_t>(assigns.size()); }
+
+    // false once the clauses are known to be unsatisfiable
+    bool add_clause(std::vector<Lit> lits) {
+        if (!ok)
+            return false;
+
+        std::sort(lits.begin(), lits.end());
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < lits.size(); i++) {
+            if (value(lits[i]) == boolalg_detail::L_TRUE || (j > 0 && lits[i] == (lits[j - 1] ^ 1)))
+                return true;// satisfied, or x + !x
+            if (value(lits[i]) != boolalg_detail::L_FALSE && (j == 0 || lits[i] != lits[j - 1]))
+                lits[j++] = lits[i];
+        }
+        lits.resize(j);
+
+        if (lits.empty())
+            return ok = false;
+        if (lits.size() == 1) {
+            enqueue(lits[0], NO_CLAUSE);
+            return ok = propagate() == NO_CLAUSE;
+        }
+        attach(store(lits, false, 0));
+        return true;
+    }
+
+    // Searches for an assignment satisfying every clause. Clauses can be added between calls.
+    SatResult solve(uint64_t max_conflicts = UINT64_MAX) {
+        model.clear();
+        if (!ok)
+            return SatResult::UNSAT;
+
+        max_learnts = std::max(max_learnts, (clauses.size() - learnts) / 3);
+        std::vector<Lit> learnt;
+        uint64_t spent = 0;
+        for (uint64_t restart = 0;; restart++) {
+            uint64_t budget = boolalg_detail::luby(restart) * RESTART_BASE;
+            for (uint64_t here = 0;;) {
+                uint32_t confl = propagate();
+                if (confl != NO_CLAUSE) {
+                    conflicts++;
+                    here++;
+                    spent++;
+                    if (trail_lim.empty()) {
+                        ok = false;
+                        return SatResult::UNSAT;
+                    }
+
+                    uint32_t back = analyze(confl, learnt);
+                    cancel_until(back);
+                    if (learnt.size() == 1) {
+                        enqueue(learnt[0], NO_CLAUSE);
+                    } else {
+                        uint32_t c = store(learnt, true, lbd(learnt));
+                        attach(c);
+                        bump_clause(c);
+                        enqueue(learnt[0], c);
+                    }
+                    var_inc /= VAR_DECAY;
+                    clause_inc /= CLAUSE_DECAY;
+                    continue;
+                }
+
+                if (spent >= max_conflicts) {
+                    cancel_until(0);
+                    return SatResult::UNKNOWN;
+                }
+                if (here >= budget) {
+                    cancel_until(0);
+                    break;
+                }
+                if (learnts >= max_learnts)
+                    reduce();
+
+                uint32_t var = pick();
+                if (var == NO_VAR) {
+                    model.assign(assigns.begin(), assigns.end());
+                    cancel_until(0);
+                    return SatResult::SAT;
+                }
+                decisions++;
+                trail_lim.push_back(static_cast<uint32_t>(trail.size()));
+                enqueue(make_lit(var, phase[var]), NO_CLAUSE);
+            }
+        }
+    }
+
+    // the value of var in the assignment the last successful solve() found
+    [[nodiscard]] bool model_value(uint32_t var) const { return model[var] == boolalg_detail::L_TRUE; }
+
+    uint64_t conflicts = 0, decisions = 0, propagations = 0;
+
+private:
+    constexpr static uint32_t NO_CLAUSE = UINT32_MAX;
+    constexpr static uint32_t NO_VAR = UINT32_MAX;
+    constexpr static uint32_t NOT_IN_HEAP = UINT32_MAX;
+    constexpr static double VAR_DECAY = 0.95;
+    constexpr static double CLAUSE_DECAY = 0.999;
+
+    struct Clause {
+        uint32_t start, size;// in lits
+        uint32_t lbd;// distinct decision levels when learnt
+        bool learnt;
+        float activity;
+    };
+
+    // the clause watches ~lit; blocker is some literal of it, checked first
+    struct Watch {
+        uint32_t clause;
+        Lit blocker;
+    };
+
+    bool ok = true;
+
+    std::vector<Clause> clauses;
+    std::vector<Lit> lits;// clause literals, back to back
+    std::vector<std::vector<Watch>> watches;// by literal: the clauses to visit when it becomes true
+    std::size_t learnts = 0;
+    std::size_t max_learnts = 2000;
+
+    std::vector<uint8_t> assigns;// by variable: L_FALSE, L_TRUE or L_UNDEF
+    std::vector<uint32_t> level, reason;
+    std::vector<bool> phase;// negated on the last assignment; new decisions reuse it
+    std::vector<bool> seen;
+    std::vector<uint8_t> model;
+
+    std::vector<Lit> trail;
+    std::vector<uint32_t> trail_lim;// where each decision level starts on the trail
+    std::size_t qhead = 0;
+
+    // VSIDS: a max-heap of unassigned variables by activity
+    std::vector<double> activity;
+    std::vector<uint32_t> heap, heap_pos;
+    double var_inc = 1, clause_inc = 1;
+
+    [[nodiscard]] uint8_t value(Lit lit) const {
+        uint8_t a = assigns[lit_var(lit)];
+        return a == boolalg_detail::L_UNDEF ? a : a ^ static_cast<uint8_t>(lit_negated(lit));
+    }
+
+    [[nodiscard]] uint32_t decision_level() const { return static_cast<uint32_t>(trail_lim.size()); }
+
+    void enqueue(Lit lit, uint32_t why) {
+        uint32_t var = lit_var(lit);
+        assigns[var] = !lit_negated(lit);
+        level[var] = decision_level();
+        reason[var] = why;
+        trail.push_back(lit);
+    }
+
+    uint32_t store(const std::vector<Lit> &c, bool learnt, uint32_t lbd) {
+        clauses.push_back({static_cast<uint32_t>(lits.size()), static_cast<uint32_t>(c.size()), lbd, learnt, 0});
+        lits.insert(lits.end(), c.begin(), c.end());
+        learnts += learnt;
+        return static_cast<uint32_t>(clauses.size() - 1);
+    }
+
+    void attach(uint32_t c) {
+        const Lit *l = &lits[clauses[c].start];
+        watches[l[0] ^ 1].push_back({c, l[1]});
+        watches[l[1] ^ 1].push_back({c, l[0]});
+    }
+
+    // unit propagation to a fixpoint; the conflicting clause, or NO_CLAUSE
+    uint32_t propagate() {
+        while (qhead < trail.size()) {
+            Lit p = trail[qhead++];
+            Lit false_lit = p ^ 1;
+            std::vector<Watch> &ws = watches[p];
+            propagations++;
+
+            std::size_t i = 0, j = 0;
+            while (i < ws.size()) {
+                Watch w = ws[i++];
+                if (value(w.blocker) == boolalg_detail::L_TRUE) {
+                    ws[j++] = w;
+                    continue;
+                }
+
+                // keep the false literal at [1]
+                Clause &c = clauses[w.clause];
+                Lit *l = &lits[c.start];
+                if (l[0] == false_lit)
+                    std::swap(l[0], l[1]);
+                Watch kept{w.clause, l[0]};
+                if (l[0] != w.blocker && value(l[0]) == boolalg_detail::L_TRUE) {
+                    ws[j++] = kept;
+                    continue;
+                }
+
+                bool moved = false;
+                for (uint32_t k = 2; k < c.size && !moved; k++)
+                    if (value(l[k]) != boolalg_detail::L_FALSE) {
+                        std::swap(l[1], l[k]);
+                        watches[l[1] ^ 1].push_back(kept);
+                        moved = true;
+                    }
+                if (moved)
+                    continue;
+
+                ws[j++] = kept;
+                if (value(l[0]) == boolalg_detail::L_FALSE) {
+                    while (i < ws.size())
+                        ws[j++] = ws[i++];
+                    ws.resize(j);
+                    qhead = trail.size();
+                    return w.clause;
+                }
+                enqueue(l[0], w.clause);
+            }
+            ws.resize(j);
+        }
+        return NO_CLAUSE;
+    }
+
+    // First UIP: resolves the conflict back to a clause with a single literal of the current
+    // level, which goes first. Returns the level to go back to, and leaves the literal of that
+    // level second.
+    uint32_t analyze(uint32_t confl, std::vector<Lit> &learnt) {
+        learnt.assign(1, 0);
+        uint32_t open = 0;
+        Lit p = 0;
+        bool first = true;
+        std::size_t index = trail.size();
+
+        do {
+            Clause &c = clauses[confl];
+            if (c.learnt)
+                bump_clause(confl);
+            for (uint32_t k = first ? 0 : 1; k < c.size; k++) {
+                Lit q = lits[c.start + k];
+                uint32_t var = lit_var(q);
+                if (seen[var] || level[var] == 0)
+                    continue;
+                seen[var] = true;
+                bump_var(var);
+                if (level[var] >= decision_level())
+                    open++;
+                else
+                    learnt.push_back(q);
+            }
+
+            while (!seen[lit_var(trail[--index])]) {}
+            p = trail[index];
+            confl = reason[lit_var(p)];
+            seen[lit_var(p)] = false;
+            open--;
+            first = false;
+        } while (open > 0);
+        learnt[0] = p ^ 1;
+
+        // drops literals implied by the others through their reason
+        std::vector<Lit> all = learnt;
+        std::size_t j = 1;
+        for (std::size_t i = 1; i < learnt.size(); i++) {
+            uint32_t why = reason[lit_var(learnt[i])];
+            bool redundant = why != NO_CLAUSE;
+            for (uint32_t k = 1; redundant && k < clauses[why].size; k++) {
+                uint32_t var = lit_var(lits[clauses[why].start + k]);
+                redundant = seen[var] || level[var] == 0;
+            }
+            if (!redundant)
+                learnt[j++] = learnt[i];
+        }
+        learnt.resize(j);
+        for (Lit lit: all)
+            seen[lit_var(lit)] = false;
+
+        if (learnt.size() == 1)
+            return 0;
+        std::size_t max = 1;
+        for (std::size_t i = 2; i < learnt.size(); i++)
+            if (level[lit_var(learnt[i])] > level[lit_var(learnt[max])])
+                max = i;
+        std::swap(learnt[1], learnt[max]);
+        return level[lit_var(learnt[1])];
+    }
+
+    uint32_t lbd(const std::vector<Lit> &c) {
+        std::vector<uint32_t> levels;
+        for (Lit lit: c)
+            levels.push_back(level[lit_var(lit)]);
+        std::sort(levels.begin(), levels.end());
+        return static_cast<uint32_t>(std::unique(levels.begin(), levels.end()) - levels.begin());
+    }
+
+    void cancel_until(uint32_t target) {
+        if (decision_level() <= target)
+            return;
+        for (std::size_t i = trail.size(); i-- > trail_lim[target];) {
+            uint32_t var = lit_var(trail[i]);
+            phase[var] = lit_negated(trail[i]);
+            assigns[var] = boolalg_detail::L_UNDEF;
+            reason[var] = NO_CLAUSE;
+            if (heap_pos[var] == NOT_IN_HEAP)
+                heap_insert(var);
+        }
+        trail.resize(trail_lim[target]);
+        trail_lim.resize(target);
+        qhead = trail.size();
+    }
+
+    // the unassigned variable with the highest activity, or NO_VAR
+    uint32_t pick() {
+        while (!heap.empty()) {
+            uint32_t var = heap_pop();
+            if (assigns[var] == boolalg_detail::L_UNDEF)
+                return var;
+        }
+        return NO_VAR;
+    }
+
+    void bump_var(uint32_t var) {
+        if ((activity[var] += var_inc) > 1e100) {
+            for (double &a: activity)
+                a *= 1e-100;
+            var_inc *= 1e-100;
+        }
+        if (heap_pos[var] != NOT_IN_HEAP)
+            heap_up(heap_pos[var]);
+    }
+
+    void bump_clause(uint32_t c) {
+        if ((clauses[c].activity += static_cast<float>(clause_inc)) > 1e20f) {
+            for (Clause &cl: clauses)
+                cl.activity *= 1e-20f;
+            clause_inc *= 1e-20;
+        }
+    }
+
+    // Deletes the worse half of the learnt clauses, by LBD and then activity, except the
+    // ones with LBD 2 and the reasons of current assignments, and compacts the clause store.
+    void reduce() {
+        std::vector<uint32_t> order;
+        for (uint32_t c = 0; c < clauses.size(); c++)
+            if (clauses[c].learnt)
+                order.push_back(c);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            if (clauses[a].lbd != clauses[b].lbd)
+                return clauses[a].lbd > clauses[b].lbd;
+            return clauses[a].activity < clauses[b].activity;
+        });
+
+        std::vector<bool> remove(clauses.size(), false);
+        for (std::size_t i = 0; i < order.size() / 2; i++) {
+            uint32_t c = order[i];
+            Lit first = lits[clauses[c].start];
+            bool locked = reason[lit_var(first)] == c && value(first) == boolalg_detail::L_TRUE;
+            remove[c] = !locked && clauses[c].lbd > 2;
+        }
+
+        std::vector<uint32_t> moved_to(clauses.size(), NO_CLAUSE);
+        std::vector<Clause> kept;
+        std::vector<Lit> kept_lits;
+        for (uint32_t c = 0; c < clauses.size(); c++) {
+            if (remove[c])
+                continue;
+            moved_to[c] = static_cast<uint32_t>(kept.size());
+            kept.push_back(clauses[c]);
+            kept.back().start = static_cast<uint32_t>(kept_lits.size());
+            kept_lits.insert(kept_lits.end(), lits.begin() + clauses[c].start, lits.begin() + clauses[c].start + clauses[c].size);
+        }
+        clauses = std::move(kept);
+        lits = std::move(kept_lits);
+
+        for (uint32_t &why: reason)
+            if (why != NO_CLAUSE)
+                why = moved_to[why];
+        for (std::vector<Watch> &ws: watches) {
+            std::size_t j = 0;
+            for (Watch w: ws)
+                if (moved_to[w.clause] != NO_CLAUSE)
+                    ws[j++] = {moved_to[w.clause], w.blocker};
+            ws.resize(j);
+        }
+
+        learnts = 0;
+        for (const Clause &c: clauses)
+            learnts += c.learnt;
+        max_learnts += max_learnts / 10;
+    }
+
+    void heap_insert(uint32_t var) {
+        heap_pos[var] = static_cast<uint32_t>(heap.size());
+        heap.push_back(var);
+        heap_up(heap_pos[var]);
+    }
+
+    uint32_t heap_pop() {
+        uint32_t top = heap[0];
+        heap[0] = heap.back();
+        heap_pos[heap[0]] = 0;
+        heap.pop_back();
+        heap_pos[top] = NOT_IN_HEAP;
+        if (!heap.empty())
+            heap_down(0);
+        return top;
+    }
+
+    void heap_up(uint32_t i) {
+        uint32_t var = heap[i];
+        while (i > 0 && activity[heap[(i - 1) / 2]] < activity[var]) {
+            heap[i] = heap[(i - 1) / 2];
+            heap_pos[heap[i]] = i;
+            i = (i - 1) / 2;
+        }
+        heap[i] = var;
+        heap_pos[var] = i;
+    }
+
+    void heap_down(uint32_t i) {
+        uint32_t var = heap[i];
+        for (;;) {
+            uint32_t child = 2 * i + 1;
+            if (child >= heap.size())
+                break;
+            if (child + 1 < heap.size() && activity[heap[child + 1]] > activity[heap[child]])
+                child++;
+            if (activity[heap[child]] <= activity[var])
+                break;
+            heap[i] = heap[child];
+            heap_pos[heap[i]] = i;
+            i = child;
+        }
+        heap[i] = var;
+        heap_pos[var] = i;
+    }
+};
+
+// Tseitin encoding: each AND/OR node gets a solver variable constrained to equal it, so the
+// clauses grow linearly with the pool DAG. Pool variables get solver variables on first use.
+class CnfEncoder {
+public:
+    CnfEncoder(ExprPool &pool, Solver &solver) : pool(pool), solver(solver) {}
+
+    // a solver literal equal to the node
+    Lit encode(BoolNodeId id) {
+        if (id < memo.size() && memo[id] != NO_LIT)
+            return memo[id];
+
+        const BoolNode n = pool[id];
+        Lit ret;
+        switch (n.kind) {
+            case BoolNodeKind::CONST:
+                if (true_lit == NO_LIT) {
+                    true_lit = make_lit(solver.new_var(), false);
+                    solver.add_clause({true_lit});
+                }
+                ret = true_lit ^ static_cast<Lit>(n.arg == 0);
+                break;
+            case BoolNodeKind::LIT:
+                ret = make_lit(solver_var(lit_var(n.arg)), lit_negated(n.arg));
+                break;
+            case BoolNodeKind::NOT:
+                ret = encode(n.arg) ^ 1;
+                break;
+            default: {
+                // AND: g -> op for each op, and (all ops) -> g; OR is the same with every
+                // literal negated
+                Lit flip = n.kind == BoolNodeKind::OR;
+                std::vector<Lit> ops;
+                for (BoolNodeId op: pool.operands(id))
+                    ops.push_back(encode(op) ^ flip);
+
+                Lit g = make_lit(solver.new_var(), false);
+                std::vector<Lit> all{g ^ flip};
+                for (Lit op: ops) {
+                    solver.add_clause({g ^ flip ^ 1, op});
+                    all.push_back(op ^ 1);
+                }
+                solver.add_clause(std::move(all));
+                ret = g;
+                break;
+            }
+        }
+
+        if (memo.size() <= id)
+            memo.resize(pool.size(), NO_LIT);
+        memo[id] = ret;
+        return ret;
+    }
+
+    // Adds the node as a constraint. ANDs at the top become separate constraints and ORs of
+    // them single clauses, so clause-shaped input needs no gate variables there.
+    void require(BoolNodeId id) {
+        const BoolNode &n = pool[id];
+        if (n.kind == BoolNodeKind::AND) {
+            for (BoolNodeId op: pool.operands(id))
+                require(op);
+        } else if (n.kind == BoolNodeKind::OR) {
+            std::vector<Lit> clause;
+            for (BoolNodeId op: pool.operands(id))
+                clause.push_back(encode(op));
+            solver.add_clause(std::move(clause));
+        } else {
+            solver.add_clause({encode(id)});
+        }
+    }
+
+    // writes the solver's model into the Values of the pool variables it has seen
+    void store_model() {
+        for (uint32_t var = 0; var < var_map.size(); var++)
+            if (var_map[var] != NO_VAR)
+                pool.value(var)->value = solver.model_value(var_map[var]);
+    }
+
+private:
+    constexpr static Lit NO_LIT = UINT32_MAX;
+    constexpr static uint32_t NO_VAR = UINT32_MAX;
+
+    ExprPool &pool;
+    Solver &solver;
+    std::vector<Lit> memo;// by node
+    std::vector<uint32_t> var_map;// pool variable to solver variable
+    Lit true_lit = NO_LIT;
+
+    uint32_t solver_var(uint32_t var) {
+        if (var_map.size() <= var)
+            var_map.resize(pool.var_count(), NO_VAR);
+        if (var_map[var] == NO_VAR)
+            var_map[var] = solver.new_var();
+        return var_map[var];
+    }
+};
+
+// Whether some assignment makes the node true. If one does, it is written into the Values of
+// the node's variables (see ExprPool::value()).
+inline bool satisfiable(ExprPool &pool, BoolNodeId id) {
+    Solver solver;
+    CnfEncoder cnf{pool, solver};
+    cnf.require(id);
+    if (solver.solve() != SatResult::SAT)
+        return false;
+    cnf.store_model();
+    return true;
+}
+
+inline bool satisfiable(const PExpr &expr) {
+    ExprPool pool;
+    return satisfiable(pool, pool.from_expr(expr));
+}
+
+// Whether every assignment makes expr true; if not, a counterexample is written into the
+// Values of its variables.
+inline bool tautology(const PExpr &expr) {
+    ExprPool pool;
+    return !satisfiable(pool, pool.negate(pool.from_expr(expr)));
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "boolalg.hpp"
+#include "boolalg/dag.hpp"
+
+// The text form of boolean expressions, as Expr::to_string() writes them:
+//
+//   sum     := product ('+' product)*
+//   product := factor ('*' factor)*
+//   factor  := '!' factor | '(' sum ')' | 'TRUE' | 'FALSE' | name
+//
+// Names are letters, digits and '_', not starting with a digit. Whitespace is ignored.
+
+class ParseError : public std::runtime_error {
+public:
+    std::size_t pos;// offset into the text
+
+    ParseError(const std::string &what, std::size_t pos) : std::runtime_error(what + " at offset " + std::to_string(pos)), pos(pos) {}
+};
+
+namespace boolalg_detail {
+
+class Parser {
+public:
+    Parser(ExprPool &pool, std::string_view text) : pool(pool), text(text) {}
+
+    BoolNodeId parse() {
+        BoolNodeId ret = sum();
+        skip_space();
+        if (pos != text.size())
+            throw ParseError{std::string{"unexpected '"} + text[pos] + "'", pos};
+        return ret;
+    }
+
+private:
+    ExprPool &pool;
+    std::string_view text;
+    std::size_t pos = 0;
+    std::vector<BoolNodeId> stack;// operands of the open sums and products
+
+    static bool is_name_start(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    static bool is_name_char(char c) { return is_name_start(c) || (c >= '0' && c <= '9'); }
+
+    void skip_space() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n'))
+            pos++;
+    }
+
+    bool accept(char c) {
+        skip_space();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    // the operands of both go through `stack`, so a long sum allocates nothing per term
+    BoolNodeId sum() {
+        std::size_t base = stack.size();
+        stack.push_back(product());
+        while (accept('+'))
+            stack.push_back(product());
+        return close(base, BoolNodeKind::OR);
+    }
+
+    BoolNodeId product() {
+        std::size_t base = stack.size();
+        stack.push_back(factor());
+        while (accept('*'))
+            stack.push_back(factor());
+        return close(base, BoolNodeKind::AND);
+    }
+
+    BoolNodeId close(std::size_t base, BoolNodeKind kind) {
+        BoolNodeId ret = stack[base];
+        if (stack.size() - base > 1) {
+            std::vector<BoolNodeId> ops(stack.begin() + static_cast<std::ptrdiff_t>(base), stack.end());
+            ret = kind == BoolNodeKind::AND ? pool.conj(std::move(ops)) : pool.disj(std::move(ops));
+        }
+        stack.resize(base);
+        return ret;
+    }
+
+    BoolNodeId factor() {
+        skip_space();
+        if (pos == text.size())
+            throw ParseError{"unexpected end of input", pos};
+
+        if (accept('!'))
+            return pool.negate(factor());
+
+        std::size_t start = pos;
+        if (accept('(')) {
+            BoolNodeId ret = sum();
+            if (!accept(')'))
+                throw ParseError{"unclosed '('", start};
+            return ret;
+        }
+
+        if (!is_name_start(text[pos]))
+            throw ParseError{std::string{"unexpected '"} + text[pos] + "'", pos};
+        while (pos < text.size() && is_name_char(text[pos]))
+            pos++;
+
+        std::string_view name = text.substr(start, pos - start);
+        if (name == "TRUE")
+            return pool.constant(true);
+        if (name == "FALSE")
+            return pool.constant(false);
+        return pool.var(name);
+    }
+};
+
+// binding strength, for deciding on parentheses
+constexpr int PREC_OR = 1, PREC_AND = 2, PREC_NOT = 3;
+
+inline void write(const ExprPool &pool, BoolNodeId id, std::string &out, int outer) {
+    const BoolNode &n = pool[id];
+    switch (n.kind) {
+        case BoolNodeKind::CONST:
+            out += n.arg ? "TRUE" : "FALSE";
+            return;
+        case BoolNodeKind::LIT:
+            if (lit_negated(n.arg))
+                out += '!';
+            out += pool.var_name(lit_var(n.arg));
+            return;
+        case BoolNodeKind::NOT:
+            out += '!';
+            write(pool, n.arg, out, PREC_NOT);
+            return;
+        default: {
+            int prec = n.kind == BoolNodeKind::AND ? PREC_AND : PREC_OR;
+            if (prec < outer)
+                out += '(';
+            bool first = true;
+            for (BoolNodeId op: pool.operands(id)) {
+                if (!first)
+                    out += n.kind == BoolNodeKind::AND ? " * " : " + ";
+                first = false;
+                write(pool, op, out, prec + 1);
+            }
+            if (prec < outer)
+                out += ')';
+        }
+    }
+}
+
+inline void write(Expr *expr, std::string &out, int outer) {
+    if (auto c = dynamic_cast<Constant *>(expr)) {
+        out += c->value ? "TRUE" : "FALSE";
+    } else if (auto v = dynamic_cast<Variable *>(expr)) {
+        if (v->inv)
+            out += '!';
+        out += v->value->name;
+    } else if (auto n = dynamic_cast<Not *>(expr)) {
+        out += '!';
+        write(n->next.get(), out, PREC_NOT);
+    } else {
+        auto a = dynamic_cast<And *>(expr);
+        auto o = dynamic_cast<Or *>(expr);
+        if (!a && !o)
+            throw std::runtime_error{"Unknown expression type"};
+
+        const std::vector<PExpr> &children = a ? a->children : o->children;
+        int prec = a ? PREC_AND : PREC_OR;
+        if (children.empty()) {
+            out += a ? "TRUE" : "FALSE";
+            return;
+        }
+        if (prec < outer)
+            out += '(';
+        for (std::size_t i = 0; i < children.size(); i++) {
+            if (i > 0)
+                out += a ? " * " : " + ";
+            write(children[i].get(), out, prec + 1);
+        }
+        if (prec < outer)
+            out += ')';
+    }
+}
+
+}// namespace boolalg_detail
+
+// Parses text into the pool; names are interned as pool variables. Throws ParseError.
+inline BoolNodeId parse(ExprPool &pool, std::string_view text) {
+    return boolalg_detail::Parser{pool, text}.parse();
+}
+
+// Parses text into an Expr tree; every occurrence of a name shares one Value
+inline PExpr parse(std::string_view text) {
+    ExprPool pool;
+    return pool.to_expr(parse(pool, text));
+}
+
+// Appends the node to out, in the syntax parse() reads, with only the parentheses needed
+inline void write(const ExprPool &pool, BoolNodeId id, std::string &out) {
+    boolalg_detail::write(pool, id, out, 0);
+}
+
+inline void write(const PExpr &expr, std::string &out) {
+    boolalg_detail::write(expr.get(), out, 0);
+}
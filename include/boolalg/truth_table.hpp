@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "boolalg/dag.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BOOLALG_AVX2 1
+#endif
+
+// Evaluation of an expression on many assignments at once. The DAG is flattened into a
+// linear tape of binary instructions, and every value on the tape is a bitset holding the
+// results for 64 assignments (256 with AVX2), so one pass over the tape evaluates them all.
+//
+// Assignment number m sets input i to bit i of m.
+
+// Truth tables and equivalence checks enumerate all 2^n assignments; beyond this they would
+// take far too long.
+constexpr uint32_t TRUTH_TABLE_MAX_VARS = 32;
+
+namespace boolalg_detail {
+
+// 64 assignments per value
+struct ScalarLanes {
+    typedef uint64_t reg;
+    constexpr static uint32_t log_width = 6;
+
+    static reg ones() { return ~uint64_t{0}; }
+    static reg zero() { return 0; }
+    static reg and_(reg a, reg b) { return a & b; }
+    static reg or_(reg a, reg b) { return a | b; }
+    static reg xor_(reg a, reg b) { return a ^ b; }
+    static bool any(reg a) { return a != 0; }
+    static void store(uint64_t *p, reg a) { *p = a; }
+
+    // input `var` over the assignments block * 64 .. block * 64 + 63
+    static reg input(uint32_t var, uint64_t block);
+};
+
+// input i < 6 alternates every 2^i assignments within a word
+constexpr uint64_t INPUT_PATTERNS[6] = {
+        0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL};
+
+inline uint64_t ScalarLanes::input(uint32_t var, uint64_t block) {
+    if (var < 6)
+        return INPUT_PATTERNS[var];
+    return block >> (var - 6) & 1 ? ones() : zero();
+}
+
+#ifdef BOOLALG_AVX2
+// 256 assignments per value, 64 per 64-bit lane
+struct Avx2Lanes {
+    typedef __m256i reg;
+    constexpr static uint32_t log_width = 8;
+
+    static reg ones() { return _mm256_set1_epi64x(-1); }
+    static reg zero() { return _mm256_setzero_si256(); }
+    static reg and_(reg a, reg b) { return _mm256_and_si256(a, b); }
+    static reg or_(reg a, reg b) { return _mm256_or_si256(a, b); }
+    static reg xor_(reg a, reg b) { return _mm256_xor_si256(a, b); }
+    static bool any(reg a) { return !_mm256_testz_si256(a, a); }
+    static void store(uint64_t *p, reg a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), a); }
+
+    static reg input(uint32_t var, uint64_t block) {
+        if (var < 6)
+            return _mm256_set1_epi64x(static_cast<int64_t>(INPUT_PATTERNS[var]));
+        if (var == 6)
+            return _mm256_set_epi64x(-1, 0, -1, 0);
+        if (var == 7)
+            return _mm256_set_epi64x(-1, -1, 0, 0);
+        return block >> (var - 8) & 1 ? ones() : zero();
+    }
+};
+#endif
+
+}// namespace boolalg_detail
+
+// An expression compiled to straight-line code over bitsets. Registers are reused once
+// their value is dead, so that even a large tape works on a register file that stays in L1.
+class Tape {
+public:
+    enum Op : uint8_t {
+        INPUT,// r[dst] = input a, negated if b
+        CONST,// r[dst] = a ? all ones : 0
+        NOT,  // r[dst] = ~r[a]
+        AND,  // r[dst] = r[a] & r[b]
+        OR    // r[dst] = r[a] | r[b]
+    };
+
+    struct Instr {
+        Op op;
+        uint32_t dst, a, b;
+    };
+
+    // Compiles the given roots, which become outputs 0, 1, ... Input i is pool variable
+    // inputs[i]; every variable the roots use must be listed.
+    Tape(const ExprPool &pool, const std::vector<BoolNodeId> &roots, std::vector<uint32_t> inputs)
+        : inputs(std::move(inputs)) {
+        std::unordered_map<uint32_t, uint32_t> input_of;
+        for (uint32_t i = 0; i < this->inputs.size(); i++)
+            input_of.emplace(this->inputs[i], i);
+
+        std::unordered_map<BoolNodeId, uint32_t> value;
+        for (BoolNodeId root: roots)
+            outputs.push_back(compile(pool, root, input_of, value));
+        allocate();
+    }
+
+    // every variable that occurs under the roots, in pool order
+    static std::vector<uint32_t> support(const ExprPool &pool, const std::vector<BoolNodeId> &roots) {
+        std::vector<bool> seen(pool.size()), used(pool.var_count());
+        std::vector<BoolNodeId> stack = roots;
+        while (!stack.empty()) {
+            BoolNodeId id = stack.back();
+            stack.pop_back();
+            if (seen[id])
+                continue;
+            seen[id] = true;
+
+            const BoolNode &n = pool[id];
+            if (n.kind == BoolNodeKind::LIT)
+                used[lit_var(n.arg)] = true;
+            else if (n.kind == BoolNodeKind::NOT)
+                stack.push_back(n.arg);
+            else if (n.kind == BoolNodeKind::AND || n.kind == BoolNodeKind::OR)
+                stack.insert(stack.end(), pool.operands(id).begin(), pool.operands(id).end());
+        }
+
+        std::vector<uint32_t> ret;
+        for (uint32_t var = 0; var < used.size(); var++)
+            if (used[var])
+                ret.push_back(var);
+        return ret;
+    }
+
+    [[nodiscard]] std::size_t size() const { return code.size(); }
+    [[nodiscard]] uint32_t registers() const { return regs; }
+    [[nodiscard]] const std::vector<Instr> &instructions() const { return code; }
+    [[nodiscard]] const std::vector<uint32_t> &input_vars() const { return inputs; }
+
+    // Runs the tape once: in[i] holds 64 values of input i, out[k] receives output k.
+    void eval(const uint64_t *in, uint64_t *out) const {
+        std::vector<uint64_t> r(regs);
+        run<boolalg_detail::ScalarLanes>(r.data(), 1, [&](uint32_t var, uint32_t) { return in[var]; });
+        for (std::size_t k = 0; k < outputs.size(); k++)
+            out[k] = r[outputs[k]];
+    }
+
+    // Output k on every assignment of the inputs, as 2^n bits packed into words (at least one).
+    [[nodiscard]] std::vector<uint64_t> truth_table(std::size_t k = 0) const {
+        check_size();
+        std::vector<uint64_t> ret(std::max<uint64_t>(1, (uint64_t{1} << inputs.size()) / 64));
+        for_each_block([&](auto lanes, uint64_t block, const auto *out) {
+            using L = decltype(lanes);
+            L::store(ret.data() + (block << (L::log_width - 6)), out[k]);
+            return true;
+        });
+
+        if (inputs.size() < 6)
+            ret[0] &= (uint64_t{1} << (uint64_t{1} << inputs.size())) - 1;
+        return ret;
+    }
+
+    // whether outputs j and k agree on every assignment
+    [[nodiscard]] bool equivalent(std::size_t j, std::size_t k) const {
+        check_size();
+        uint64_t mask = inputs.size() < 6 ? (uint64_t{1} << (uint64_t{1} << inputs.size())) - 1 : ~uint64_t{0};
+
+        bool same = true;
+        for_each_block([&](auto lanes, uint64_t, const auto *out) {
+            using L = decltype(lanes);
+            typename L::reg diff = L::xor_(out[j], out[k]);
+            if constexpr (std::is_same_v<L, boolalg_detail::ScalarLanes>)
+                diff &= mask;// fewer than 64 assignments
+            same = !L::any(diff);
+            return same;
+        });
+        return same;
+    }
+
+private:
+    std::vector<uint32_t> inputs;
+    std::vector<Instr> code;
+    std::vector<uint32_t> outputs;// registers
+    uint32_t regs = 0;
+
+    // blocks evaluated per pass over the tape, to spread the dispatch cost
+    constexpr static uint32_t BATCH = 16;
+
+    void check_size() const {
+        if (inputs.size() > TRUTH_TABLE_MAX_VARS)
+            throw std::invalid_argument{"too many variables to enumerate"};
+    }
+
+    uint32_t emit(Op op, uint32_t a, uint32_t b) {
+        code.push_back({op, 0, a, b});
+        return static_cast<uint32_t>(code.size() - 1);
+    }
+
+    // emits code for id and returns the instruction computing it
+    uint32_t compile(const ExprPool &pool, BoolNodeId id, const std::unordered_map<uint32_t, uint32_t> &input_of,
+                     std::unordered_map<BoolNodeId, uint32_t> &value) {
+        auto it = value.find(id);
+        if (it != value.end())
+            return it->second;
+
+        const BoolNode &n = pool[id];
+        uint32_t ret;
+        switch (n.kind) {
+            case BoolNodeKind::CONST:
+                ret = emit(CONST, n.arg, 0);
+                break;
+            case BoolNodeKind::LIT: {
+                auto in = input_of.find(lit_var(n.arg));
+                if (in == input_of.end())
+                    throw std::invalid_argument{"variable " + pool.var_name(lit_var(n.arg)) + " is not an input"};
+                ret = emit(INPUT, in->second, lit_negated(n.arg));
+                break;
+            }
+            case BoolNodeKind::NOT:
+                ret = emit(NOT, compile(pool, n.arg, input_of, value), 0);
+                break;
+            default: {
+                Op op = n.kind == BoolNodeKind::AND ? AND : OR;
+                ExprPool::Operands ops = pool.operands(id);
+                ret = compile(pool, ops[0], input_of, value);
+                for (std::size_t i = 1; i < ops.size(); i++)
+                    ret = emit(op, ret, compile(pool, ops[i], input_of, value));
+                break;
+            }
+        }
+
+        value.emplace(id, ret);
+        return ret;
+    }
+
+    // Assigns registers: a value's register is freed after its last use. Outputs stay live.
+    void allocate() {
+        constexpr uint32_t FOREVER = UINT32_MAX;
+        std::vector<uint32_t> last_use(code.size(), 0);
+        for (uint32_t i = 0; i < code.size(); i++) {
+            if (code[i].op == NOT || code[i].op == AND || code[i].op == OR)
+                last_use[code[i].a] = i;
+            if (code[i].op == AND || code[i].op == OR)
+                last_use[code[i].b] = i;
+        }
+        for (uint32_t &out: outputs)
+            last_use[out] = FOREVER;
+
+        std::vector<uint32_t> free, reg(code.size());
+        for (uint32_t i = 0; i < code.size(); i++) {
+            Instr &ins = code[i];
+            bool unary = ins.op == NOT, binary = ins.op == AND || ins.op == OR;
+            if (unary || binary) {
+                if (last_use[ins.a] == i)
+                    free.push_back(reg[ins.a]);
+                if (binary && last_use[ins.b] == i && ins.b != ins.a)
+                    free.push_back(reg[ins.b]);
+                ins.a = reg[ins.a];
+                if (binary)
+                    ins.b = reg[ins.b];
+            }
+
+            if (free.empty()) {
+                reg[i] = regs++;
+            } else {
+                reg[i] = free.back();
+                free.pop_back();
+            }
+            ins.dst = reg[i];
+        }
+
+        for (uint32_t &out: outputs)
+            out = reg[out];
+    }
+
+    // One pass over the tape for `batch` blocks at once; register x of block j is
+    // r[x * batch + j], and input(var, j) gives the input values of block j.
+    template<typename L, typename In>
+    void run(typename L::reg *r, uint32_t batch, In &&input) const {
+        for (const Instr &ins: code) {
+            typename L::reg *d = r + ins.dst * batch;
+            const typename L::reg *a = r + ins.a * batch, *b = r + ins.b * batch;
+            switch (ins.op) {
+                case INPUT:
+                    for (uint32_t j = 0; j < batch; j++)
+                        d[j] = ins.b ? L::xor_(input(ins.a, j), L::ones()) : input(ins.a, j);
+                    break;
+                case CONST:
+                    for (uint32_t j = 0; j < batch; j++)
+                        d[j] = ins.a ? L::ones() : L::zero();
+                    break;
+                case NOT:
+                    for (uint32_t j = 0; j < batch; j++)
+                        d[j] = L::xor_(a[j], L::ones());
+                    break;
+                case AND:
+                    for (uint32_t j = 0; j < batch; j++)
+                        d[j] = L::and_(a[j], b[j]);
+                    break;
+                case OR:
+                    for (uint32_t j = 0; j < batch; j++)
+                        d[j] = L::or_(a[j], b[j]);
+                    break;
+            }
+        }
+    }
+
+    // f(lanes, block, outputs) for every block of assignments, until f returns false
+    template<typename F>
+    void for_each_block(F &&f) const {
+#ifdef BOOLALG_AVX2
+        if (inputs.size() >= boolalg_detail::Avx2Lanes::log_width) {
+            blocks<boolalg_detail::Avx2Lanes>(f);
+            return;
+        }
+#endif
+        blocks<boolalg_detail::ScalarLanes>(f);
+    }
+
+    template<typename L, typename F>
+    void blocks(F &f) const {
+        typedef typename L::reg reg;
+        uint64_t count = inputs.size() > L::log_width ? uint64_t{1} << (inputs.size() - L::log_width) : 1;
+        uint32_t batch = static_cast<uint32_t>(std::min<uint64_t>(BATCH, count));
+
+        // aligned by hand: std::vector drops the alignment attribute of vector registers
+        std::size_t slots = std::size_t{regs} * batch + outputs.size();
+        std::unique_ptr<void, decltype(&std::free)> storage{std::aligned_alloc(alignof(reg), slots * sizeof(reg)), &std::free};
+        if (!storage)
+            throw std::bad_alloc{};
+        reg *r = static_cast<reg *>(storage.get());
+        reg *out = r + std::size_t{regs} * batch;
+
+        for (uint64_t first = 0; first < count; first += batch) {
+            run<L>(r, batch, [&](uint32_t var, uint32_t j) { return L::input(var, first + j); });
+            for (uint32_t j = 0; j < batch; j++) {
+                for (std::size_t k = 0; k < outputs.size(); k++)
+                    out[k] = r[std::size_t{outputs[k]} * batch + j];
+                if (!f(L{}, first + j, out))
+                    return;
+            }
+        }
+    }
+};
+
+// whether a and b agree on every assignment of the variables they use
+inline bool equivalent(const ExprPool &pool, BoolNodeId a, BoolNodeId b) {
+    if (a == b)
+        return true;
+    Tape tape{pool, {a, b}, Tape::support(pool, {a, b})};
+    return tape.equivalent(0, 1);
+}
+
+inline bool equivalent(const PExpr &a, const PExpr &b) {
+    ExprPool pool;
+    BoolNodeId x = pool.from_expr(a), y = pool.from_expr(b);
+    return equivalent(pool, x, y);
+}
+
+// the value of expr under the current Value::value of its variables
+inline bool evaluate(const PExpr &expr) {
+    ExprPool pool;
+    BoolNodeId root = pool.from_expr(expr);
+    Tape tape{pool, {root}, Tape::support(pool, {root})};
+
+    std::vector<uint64_t> in;
+    for (uint32_t var: tape.input_vars())
+        in.push_back(pool.value(var)->value ? ~uint64_t{0} : 0);
+    uint64_t out;
+    tape.eval(in.data(), &out);
+    return out & 1;
+}
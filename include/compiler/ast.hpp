@@ -1,7 +1,112 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
 #include "compiler/type.hpp"
 
+#include "llvm/ADT/ArrayRef.h"
+
+using NodeIndex = uint32_t;
+constexpr NodeIndex NO_NODE = ~NodeIndex{0};
+
+// What `lhs` and `rhs` hold for each kind:
+//   INT_LITERAL, FLOAT_LITERAL   lhs: index into Ast::literals
+//   PARAM                        lhs: parameter number
+//   CALL                         lhs: index into Ast::names, rhs: list of arguments
+//   CAST, NEGATE                 lhs: operand (the target type is the node's type)
+//   ADD, SUB, MUL, DIV           lhs, rhs: operands, already converted to the node's type
+//   RETURN                       lhs: value or NO_NODE
+//   EXPR_STMT                    lhs: expression
+//   FUNCTION                     lhs: index into Ast::names, rhs: list of parameter names followed by statements
+enum class NodeKind : uint8_t {
+    INT_LITERAL,
+    FLOAT_LITERAL,
+    PARAM,
+    CALL,
+    CAST,
+    NEGATE,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    RETURN,
+    EXPR_STMT,
+    FUNCTION
+};
+
+struct Node {
+    NodeKind kind;
+    uint32_t source;// offset into the input, for diagnostics
+    NodeIndex lhs;
+    NodeIndex rhs;
+    Type *type;// type of the expression; the signature for FUNCTION; void for statements
+};
+
+static_assert(sizeof(Node) <= 24, "keep Node small, there are a lot of them");
+
+// All nodes of one compilation unit, stored by index in flat arrays so that building the tree
+// never allocates per node and the whole thing goes away with clear().
+class Ast {
+public:
+    std::vector<Node> nodes;
+    std::vector<uint32_t> extra;        // variable-length children, see add_list()
+    std::vector<uint64_t> literals;     // bit patterns of numeric literals
+    std::vector<std::string_view> names;// identifiers; these point into the source
+
+    Node &operator[](NodeIndex i) { return nodes[i]; }
+    const Node &operator[](NodeIndex i) const { return nodes[i]; }
+
+    NodeIndex add(NodeKind kind, Type *type, uint32_t source, NodeIndex lhs = NO_NODE, NodeIndex rhs = NO_NODE) {
+        nodes.push_back(Node{kind, source, lhs, rhs, type});
+        return static_cast<NodeIndex>(nodes.size() - 1);
+    }
+
+    NodeIndex add_int(Type *type, uint32_t source, uint64_t value) {
+        literals.push_back(value);
+        return add(NodeKind::INT_LITERAL, type, source, static_cast<uint32_t>(literals.size() - 1));
+    }
+
+    NodeIndex add_float(Type *type, uint32_t source, double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        literals.push_back(bits);
+        return add(NodeKind::FLOAT_LITERAL, type, source, static_cast<uint32_t>(literals.size() - 1));
+    }
+
+    uint32_t add_name(std::string_view name) {
+        names.push_back(name);
+        return static_cast<uint32_t>(names.size() - 1);
+    }
+
+    // stores [count, items...] in `extra` and returns where it starts
+    uint32_t add_list(llvm::ArrayRef<uint32_t> items) {
+        auto at = static_cast<uint32_t>(extra.size());
+        extra.push_back(static_cast<uint32_t>(items.size()));
+        extra.insert(extra.end(), items.begin(), items.end());
+        return at;
+    }
+
+    [[nodiscard]] llvm::ArrayRef<uint32_t> list(uint32_t at) const {
+        return {extra.data() + at + 1, extra[at]};
+    }
+
+    [[nodiscard]] uint64_t int_value(const Node &node) const {
+        return literals[node.lhs];
+    }
 
+    [[nodiscard]] double float_value(const Node &node) const {
+        double value;
+        std::memcpy(&value, &literals[node.lhs], sizeof(value));
+        return value;
+    }
 
+    void clear() {
+        nodes.clear();
+        extra.clear();
+        literals.clear();
+        names.clear();
+    }
+};
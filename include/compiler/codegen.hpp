@@ -0,0 +1,194 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compiler/ast.hpp"
+#include "compiler/jit_session.hpp"
+#include "compiler/passes.hpp"
+#include "compiler/type.hpp"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+
+// Lowers FUNCTION nodes of an already type-checked Ast into LLVM modules. The parser has
+// inserted every conversion as a CAST node, so this is a straight walk over the tree.
+class CodeGen {
+public:
+    const Ast &ast;
+    TypeContext &types;
+    llvm::LLVMContext &ctx;
+    llvm::IRBuilder<> builder;
+    llvm::PassManagerBuilder pm_builder{};
+
+    bool print_ir = true;
+
+    CodeGen(const Ast &ast, TypeContext &types) : ast(ast), types(types), ctx(*types.ctx), builder(ctx) {
+        configure_pass_builder(pm_builder);
+    }
+
+    // Returns nullptr if LLVM rejects the generated IR.
+    std::unique_ptr<llvm::Module> lower_function(NodeIndex index, const std::string &symbol, const llvm::DataLayout &layout) {
+        const Node &node = ast[index];
+        std::string name{ast.names[node.lhs]};
+
+        auto module = std::make_unique<llvm::Module>(name, ctx);
+        module->setDataLayout(layout);
+        cur_module = module.get();
+
+        auto *fty = llvm::cast<llvm::FunctionType>(types.lower(node.type));
+        cur_function = llvm::Function::Create(fty, llvm::Function::ExternalLinkage, symbol, module.get());
+
+        llvm::ArrayRef<uint32_t> children = ast.list(node.rhs);
+        for (uint32_t i = 0; i < node.type->num_params; i++) {
+            std::string_view param = ast.names[children[i]];
+            cur_function->getArg(i)->setName(llvm::StringRef(param.data(), param.size()));
+        }
+
+        builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", cur_function));
+        for (NodeIndex stmt: children.drop_front(node.type->num_params))
+            lower_statement(stmt);
+
+        // the parser already checked that non-void functions return
+        llvm::BasicBlock *last = builder.GetInsertBlock();
+        if (!last->getTerminator()) {
+            if (last != &cur_function->getEntryBlock() && llvm::pred_empty(last))
+                builder.CreateUnreachable();// dead block left behind by a `return`
+            else
+                builder.CreateRetVoid();
+        }
+
+        if (llvm::verifyFunction(*cur_function, &llvm::errs()))
+            return nullptr;
+
+        llvm::legacy::FunctionPassManager pm(module.get());
+        add_function_passes(pm, pm_builder);
+        pm.run(*cur_function);
+        pm.doFinalization();
+
+        if (print_ir)
+            module->print(llvm::outs(), nullptr);
+
+        cur_module = nullptr;
+        cur_function = nullptr;
+        return module;
+    }
+
+private:
+    llvm::Module *cur_module = nullptr;
+    llvm::Function *cur_function = nullptr;
+
+    void lower_statement(NodeIndex index) {
+        const Node &node = ast[index];
+        switch (node.kind) {
+            case NodeKind::RETURN:
+                if (node.lhs == NO_NODE)
+                    builder.CreateRetVoid();
+                else
+                    builder.CreateRet(lower(node.lhs));
+
+                // anything after a return still needs somewhere to go
+                builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "dead", cur_function));
+                break;
+            case NodeKind::EXPR_STMT:
+                lower(node.lhs);
+                break;
+            default:
+                lower(index);
+                break;
+        }
+    }
+
+    llvm::Value *lower(NodeIndex index) {
+        const Node &node = ast[index];
+        switch (node.kind) {
+            case NodeKind::INT_LITERAL:
+                return llvm::ConstantInt::get(types.lower(node.type), ast.int_value(node), node.type->is_signed());
+            case NodeKind::FLOAT_LITERAL:
+                return llvm::ConstantFP::get(types.lower(node.type), ast.float_value(node));
+            case NodeKind::PARAM:
+                return cur_function->getArg(node.lhs);
+            case NodeKind::CALL:
+                return lower_call(node);
+            case NodeKind::CAST:
+                return lower_cast(lower(node.lhs), ast[node.lhs].type, node.type);
+            case NodeKind::NEGATE: {
+                llvm::Value *val = lower(node.lhs);
+                return node.type->is_float() ? builder.CreateFNeg(val) : builder.CreateNeg(val);
+            }
+            case NodeKind::ADD:
+            case NodeKind::SUB:
+            case NodeKind::MUL:
+            case NodeKind::DIV:
+                return lower_arithmetic(node);
+            case NodeKind::RETURN:
+            case NodeKind::EXPR_STMT:
+            case NodeKind::FUNCTION:
+                break;
+        }
+
+        return nullptr;
+    }
+
+    llvm::Value *lower_arithmetic(const Node &node) {
+        llvm::Value *l = lower(node.lhs);
+        llvm::Value *r = lower(node.rhs);
+
+        bool is_float = node.type->is_float();
+        switch (node.kind) {
+            case NodeKind::ADD:
+                return is_float ? builder.CreateFAdd(l, r) : builder.CreateAdd(l, r);
+            case NodeKind::SUB:
+                return is_float ? builder.CreateFSub(l, r) : builder.CreateSub(l, r);
+            case NodeKind::MUL:
+                return is_float ? builder.CreateFMul(l, r) : builder.CreateMul(l, r);
+            default:
+                return is_float ? builder.CreateFDiv(l, r) : (node.type->is_signed() ? builder.CreateSDiv(l, r) : builder.CreateUDiv(l, r));
+        }
+    }
+
+    // calls load their target out of the callee's slot, see FunctionEntry::slot
+    llvm::Value *lower_call(const Node &node) {
+        std::vector<llvm::Value *> args;
+        std::vector<Type *> arg_types;
+        for (NodeIndex arg: ast.list(node.rhs)) {
+            args.push_back(lower(arg));
+            arg_types.push_back(ast[arg].type);
+        }
+
+        // arguments were converted to the parameter types, so this is the callee's (interned) signature
+        auto *signature = llvm::cast<llvm::FunctionType>(types.lower(types.function(node.type, arg_types)));
+
+        std::string name{ast.names[node.lhs]};
+        llvm::Constant *slot = cur_module->getOrInsertGlobal(JITSession::slot_name(name), builder.getInt8PtrTy());
+        llvm::Value *target = builder.CreateBitCast(builder.CreateLoad(builder.getInt8PtrTy(), slot), signature->getPointerTo());
+
+        return builder.CreateCall(signature, target, args);
+    }
+
+    llvm::Value *lower_cast(llvm::Value *val, Type *from, Type *to) {
+        llvm::Type *dst = types.lower(to);
+
+        if (to->is_bool()) {
+            if (from->is_float())
+                return builder.CreateFCmpUNE(val, llvm::ConstantFP::get(val->getType(), 0.0));
+            return builder.CreateICmpNE(val, llvm::ConstantInt::get(val->getType(), 0));
+        }
+
+        if (to->is_float()) {
+            if (from->is_float())
+                return builder.CreateFPCast(val, dst);
+            return from->is_signed() ? builder.CreateSIToFP(val, dst) : builder.CreateUIToFP(val, dst);
+        }
+
+        if (from->is_float())
+            return to->is_signed() ? builder.CreateFPToSI(val, dst) : builder.CreateFPToUI(val, dst);
+        return builder.CreateIntCast(val, dst, from->is_signed());
+    }
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct SourceRange {
+    uint32_t begin;
+    uint32_t end;// one past the last character
+};
+
+enum class Severity : uint8_t {
+    ERROR,
+    NOTE
+};
+
+struct Diagnostic {
+    Severity severity;
+    SourceRange range;
+    std::string message;
+};
+
+// Collects everything that went wrong while compiling one input, so that all of it can be
+// reported at the end of a single pass instead of stopping at the first error.
+class Diagnostics {
+public:
+    std::string_view input;
+    std::vector<std::size_t> lines;// input[lines[X]] is the beginning of line X+2.
+
+    std::vector<Diagnostic> list;
+    std::size_t errors = 0;
+    std::size_t max_errors = 256;// past this, further errors are counted but not stored
+
+    explicit Diagnostics(std::string_view input) : input(input) {}
+
+    void report(Severity severity, SourceRange range, std::string message) {
+        if (severity == Severity::ERROR && errors++ >= max_errors)
+            return;
+        list.push_back(Diagnostic{severity, range, std::move(message)});
+    }
+
+    void error(SourceRange range, std::string message) {
+        report(Severity::ERROR, range, std::move(message));
+    }
+
+    void note(SourceRange range, std::string message) {
+        report(Severity::NOTE, range, std::move(message));
+    }
+
+    [[nodiscard]] bool has_errors() const { return errors > 0; }
+
+    // 1-based line containing `index`
+    [[nodiscard]] std::size_t lookup_line_no(std::size_t index) const {
+        return 1 + (std::upper_bound(lines.begin(), lines.end(), index) - lines.begin());
+    }
+
+    [[nodiscard]] std::size_t line_begin(std::size_t line) const {
+        return line <= 1 ? 0 : lines[line - 2];
+    }
+
+    // text of a 1-based line, without its newline
+    [[nodiscard]] std::string_view get_line(std::size_t line) const {
+        std::size_t begin = line_begin(line);
+        std::size_t end = line - 1 < lines.size() ? lines[line - 1] : input.size();
+
+        std::string_view text = input.substr(begin, end - begin);
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    void print(std::ostream &out) const {
+        constexpr std::size_t LINE_LENGTH_PRINT_THRESHOLD = 256;
+
+        // errors are found out of order, e.g. a missing return only once the body has been parsed
+        std::vector<const Diagnostic *> sorted;
+        for (const Diagnostic &diag: list)
+            sorted.push_back(&diag);
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Diagnostic *a, const Diagnostic *b) {
+            return a->range.begin < b->range.begin;
+        });
+
+        for (const Diagnostic *pdiag: sorted) {
+            const Diagnostic &diag = *pdiag;
+            std::size_t line_no = lookup_line_no(diag.range.begin);
+            std::size_t col = diag.range.begin - line_begin(line_no);
+
+            out << "input[" << diag.range.begin << "] (line " << line_no << ", col " << col + 1 << "): "
+                << (diag.severity == Severity::ERROR ? "error: " : "note: ") << diag.message << '\n';
+
+            std::string_view line = get_line(line_no);
+            if (line.size() >= LINE_LENGTH_PRINT_THRESHOLD || col > line.size()) {
+                out << '\t' << line.substr(0, LINE_LENGTH_PRINT_THRESHOLD) << "...\n";
+                continue;
+            }
+
+            // underline the range, clipped to this line
+            std::size_t len = std::max<std::size_t>(1, std::min<std::size_t>(diag.range.end, line_begin(line_no) + line.size()) - diag.range.begin);
+            std::string marker;
+            for (std::size_t i = 0; i < col; i++)
+                marker += line[i] == '\t' ? '\t' : ' ';
+            marker += '^';
+            marker.append(len - 1, '~');
+
+            out << '\t' << line << "\n\t" << marker << '\n';
+        }
+
+        if (errors > max_errors)
+            out << errors - max_errors << " more errors not shown\n";
+        if (errors > 0)
+            out << errors << (errors == 1 ? " error" : " errors") << " generated.\n";
+    }
+};
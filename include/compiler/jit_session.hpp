@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "compiler/kaleidoscope_jit.hpp"
+#include "compiler/type.hpp"
+
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+// One compiled function. Each definition lives in its own module under its own
+// ResourceTracker, so it can be dropped and recompiled without touching anything else.
+struct FunctionEntry {
+    Type *signature = nullptr;// always a function type
+
+    // Callers never link against the body directly; they load its address out of this slot
+    // (exported to the JIT as "<name>.slot") and call through it. Redefinition only has to
+    // patch the slot, so code compiled against an older version keeps working.
+    std::unique_ptr<void *> slot = std::make_unique<void *>(nullptr);
+
+    llvm::orc::ResourceTrackerSP tracker;
+    std::size_t version = 0;// how many times this function has been defined
+
+    // every version gets a distinct symbol, so the new body can be materialized before the old one is removed
+    [[nodiscard]] std::string next_symbol(const std::string &name) const {
+        return name + ".v" + std::to_string(version + 1);
+    }
+};
+
+class JITSession {
+public:
+    llvm::orc::ThreadSafeContext tsc;
+    std::unique_ptr<llvm::orc::KaleidoscopeJIT> jit;
+    TypeContext types;
+
+    std::unordered_map<std::string, FunctionEntry> functions;
+
+    JITSession() : tsc(std::make_unique<llvm::LLVMContext>()), jit(llvm::cantFail(llvm::orc::KaleidoscopeJIT::Create())), types(tsc.getContext()) {}
+
+    llvm::LLVMContext *context() { return tsc.getContext(); }
+
+    static std::string slot_name(const std::string &name) {
+        return name + ".slot";
+    }
+
+    // Registers `name` so that calls to it can be compiled before (or while) its body is.
+    // Returns nullptr if `name` already exists with a different signature.
+    FunctionEntry *declare(const std::string &name, Type *signature) {
+        auto it = functions.find(name);
+        if (it != functions.end())
+            return it->second.signature == signature ? &it->second : nullptr;
+
+        FunctionEntry &entry = functions[name];
+        entry.signature = signature;
+        llvm::cantFail(jit->defineAbsolute(slot_name(name), entry.slot.get()));
+        return &entry;
+    }
+
+    // Compiles `module`, which must define entry.next_symbol(name), and swaps it in for
+    // the previous definition of `name` (if any).
+    llvm::Error define(const std::string &name, std::unique_ptr<llvm::Module> module) {
+        FunctionEntry &entry = functions.at(name);
+        std::string symbol = entry.next_symbol(name);
+
+        llvm::orc::ResourceTrackerSP tracker = jit->createResourceTracker();
+        if (auto err = jit->addModule(llvm::orc::ThreadSafeModule(std::move(module), tsc), tracker))
+            return err;
+
+        auto sym = jit->lookup(symbol);// forces compilation
+        if (!sym) {
+            llvm::consumeError(tracker->remove());
+            return sym.takeError();
+        }
+
+        *entry.slot = reinterpret_cast<void *>(sym->getAddress());
+        entry.version++;
+
+        std::swap(entry.tracker, tracker);
+        if (tracker)
+            return tracker->remove();
+        return llvm::Error::success();
+    }
+
+    template<typename F>
+    F *get(const std::string &name) {
+        auto it = functions.find(name);
+        if (it == functions.end())
+            return nullptr;
+        return reinterpret_cast<F *>(*it->second.slot);
+    }
+};
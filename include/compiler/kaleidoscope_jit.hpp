@@ -90,6 +90,18 @@
                 return CompileLayer.add(RT, std::move(TSM));
             }
 
+            ResourceTrackerSP createResourceTracker() {
+                return MainJD.createResourceTracker();
+            }
+
+            // Binds `Name` to a fixed address in this process, e.g. a slot the host
+            // patches when a function gets recompiled.
+            Error defineAbsolute(StringRef Name, void *Addr) {
+                return MainJD.define(absoluteSymbols(
+                        {{Mangle(Name.str()), JITEvaluatedSymbol(pointerToJITTargetAddress(Addr),
+                                                                 JITSymbolFlags::Exported)}}));
+            }
+
             Expected<JITEvaluatedSymbol> lookup(StringRef Name) {
                 return ES->lookup({&MainJD}, Mangle(Name.str()));
             }
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Result of scanning one numeric literal (without its type suffix).
+struct NumericLiteral {
+    bool is_float = false;
+    uint64_t integer = 0;
+    double floating = 0.0;
+
+    std::size_t length = 0;       // characters consumed
+    const char *error = nullptr;// set if the literal is malformed or doesn't fit
+};
+
+namespace literal_detail {
+    // 10^0 through 10^22 are all exactly representable as doubles
+    constexpr double EXACT_POWERS_OF_TEN[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    constexpr uint64_t MAX_EXACT_MANTISSA = uint64_t{1} << 53;
+
+    inline bool is_separator(char c) {
+        return c == '_' || c == '\'';
+    }
+
+    inline int digit_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+        return 99;
+    }
+
+    // Consumes digits of `base` starting at `in[i]`, allowing single separators between digits.
+    // Calls `on_digit` for every digit and returns the number of digits seen.
+    template<typename F>
+    inline std::size_t scan_digits(std::string_view in, std::size_t &i, int base, F &&on_digit) {
+        std::size_t count = 0;
+        while (i < in.size()) {
+            if (is_separator(in[i]) && count > 0 && i + 1 < in.size() && digit_value(in[i + 1]) < base) {
+                i++;
+                continue;
+            }
+
+            int d = digit_value(in[i]);
+            if (d >= base)
+                break;
+
+            on_digit(d);
+            count++;
+            i++;
+        }
+        return count;
+    }
+
+    // Exact fallback for everything the fast path can't prove correct. `digits` holds the
+    // literal with separators stripped; libstdc++ implements this with Eisel-Lemire.
+    inline const char *slow_path(std::string_view digits, double &out) {
+        auto res = std::from_chars(digits.data(), digits.data() + digits.size(), out);
+        if (res.ec == std::errc::result_out_of_range)
+            return "Floating point literal out of range for f64";
+        if (res.ec != std::errc{} || res.ptr != digits.data() + digits.size())
+            return "Malformed floating point literal";
+        return nullptr;
+    }
+}// namespace literal_detail
+
+// Scans an integer (0x, 0b, 0o or decimal) or a decimal float (with optional exponent)
+// from the start of `in`. Digit groups may be separated with '_' or '\''.
+inline NumericLiteral parse_numeric_literal(std::string_view in) {
+    using namespace literal_detail;
+
+    NumericLiteral ret;
+    std::size_t i = 0;
+
+    int base = 10;
+    if (in.size() > 2 && in[0] == '0') {
+        char p = static_cast<char>(in[1] | 0x20);
+        if (p == 'x') base = 16;
+        else if (p == 'b') base = 2;
+        else if (p == 'o') base = 8;
+
+        if (base != 10) {
+            i = 2;
+            bool overflow = false;
+            std::size_t n = scan_digits(in, i, base, [&](int d) {
+                overflow |= __builtin_mul_overflow(ret.integer, static_cast<uint64_t>(base), &ret.integer);
+                overflow |= __builtin_add_overflow(ret.integer, static_cast<uint64_t>(d), &ret.integer);
+            });
+
+            if (n == 0)
+                ret.error = "Expected digits after base prefix";
+            else if (overflow)
+                ret.error = "Numeric literal too large: Overflow detected in u64";
+            ret.length = i;
+            return ret;
+        }
+    }
+
+    // Decimal: the first 19 significant digits always fit in a u64 mantissa.
+    // `buf` keeps a separator-free copy for the slow path.
+    constexpr std::size_t MAX_DIGITS = 19;
+    constexpr std::size_t BUF_SIZE = 512;
+
+    char buf[BUF_SIZE];
+    std::size_t buf_len = 0;
+    bool buf_overflow = false;
+    auto keep = [&](char c) {
+        if (buf_len < BUF_SIZE) buf[buf_len++] = c;
+        else buf_overflow = true;
+    };
+
+    uint64_t mantissa = 0;
+    std::size_t significant = 0;// digits in `mantissa`, not counting leading zeros
+    bool truncated = false;      // nonzero digits past MAX_DIGITS were dropped
+    int64_t exp10 = 0;
+
+    bool int_overflow = false;
+    uint64_t integer = 0;
+
+    scan_digits(in, i, 10, [&](int d) {
+        keep(static_cast<char>('0' + d));
+        int_overflow |= __builtin_mul_overflow(integer, uint64_t{10}, &integer);
+        int_overflow |= __builtin_add_overflow(integer, static_cast<uint64_t>(d), &integer);
+
+        if (significant < MAX_DIGITS) {
+            mantissa = mantissa * 10 + d;
+            significant += mantissa != 0;
+        } else {
+            exp10++;
+            truncated |= d != 0;
+        }
+    });
+
+    if (i + 1 < in.size() && in[i] == '.' && digit_value(in[i + 1]) < 10) {
+        ret.is_float = true;
+        keep('.');
+        i++;
+
+        scan_digits(in, i, 10, [&](int d) {
+            keep(static_cast<char>('0' + d));
+            if (significant < MAX_DIGITS) {
+                mantissa = mantissa * 10 + d;
+                significant += mantissa != 0;
+                exp10--;
+            } else {
+                truncated |= d != 0;
+            }
+        });
+    }
+
+    if (i < in.size() && (in[i] | 0x20) == 'e') {
+        std::size_t j = i + 1;
+        bool negative = j < in.size() && in[j] == '-';
+        if (j < in.size() && (in[j] == '-' || in[j] == '+'))
+            j++;
+
+        int64_t exp = 0;
+        std::size_t n = scan_digits(in, j, 10, [&](int d) {
+            if (exp < 100000) exp = exp * 10 + d;// anything past this is 0 or inf anyway
+        });
+
+        // otherwise the 'e' belongs to whatever comes next (i.e. a suffix)
+        if (n > 0) {
+            ret.is_float = true;
+            keep('e');
+            if (negative) keep('-');
+            for (char c: std::to_string(exp)) keep(c);
+
+            exp10 += negative ? -exp : exp;
+            i = j;
+        }
+    }
+
+    ret.length = i;
+
+    if (!ret.is_float) {
+        ret.integer = integer;
+        if (int_overflow)
+            ret.error = "Numeric literal too large: Overflow detected in u64";
+        return ret;
+    }
+
+    // Clinger's fast path: an exact mantissa times an exact power of ten is correctly rounded
+    if (!truncated && mantissa <= MAX_EXACT_MANTISSA) {
+        if (mantissa == 0) {
+            ret.floating = 0.0;
+            return ret;
+        }
+
+        if (exp10 >= -22 && exp10 <= 22) {
+            auto m = static_cast<double>(mantissa);
+            ret.floating = exp10 < 0 ? m / EXACT_POWERS_OF_TEN[-exp10] : m * EXACT_POWERS_OF_TEN[exp10];
+            return ret;
+        }
+
+        // e.g. 123e25: move the excess power into the mantissa if it stays exact
+        if (exp10 > 22 && exp10 <= 22 + 15) {
+            uint64_t shifted = mantissa;
+            bool exact = true;
+            for (int64_t e = exp10; e > 22 && exact; e--)
+                exact = !__builtin_mul_overflow(shifted, uint64_t{10}, &shifted) && shifted <= MAX_EXACT_MANTISSA;
+
+            if (exact) {
+                ret.floating = static_cast<double>(shifted) * EXACT_POWERS_OF_TEN[22];
+                return ret;
+            }
+        }
+    }
+
+    if (buf_overflow)
+        ret.error = "Floating point literal has too many digits";
+    else
+        ret.error = slow_path(std::string_view(buf, buf_len), ret.floating);
+
+    return ret;
+}
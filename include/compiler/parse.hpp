@@ -6,8 +6,11 @@
 #include <utility>
 #include <vector>
 
+#include "compiler/ast.hpp"
+#include "compiler/codegen.hpp"
+#include "compiler/diagnostics.hpp"
 #include "compiler/operator.hpp"
-#include "compiler/value.hpp"
+#include "compiler/passes.hpp"
 
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/STLExtras.h"
@@ -20,78 +23,30 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
-#include "llvm/Pass.h"
 #include "llvm/IR/Verifier.h"
-#include "llvm/Transforms/InstCombine/InstCombine.h"
-#include "llvm/Transforms/Scalar.h"
-#include "llvm/Transforms/Scalar/GVN.h"
-#include "llvm/Transforms/Utils.h"
 
-#include "llvm/Transforms/IPO/PassManagerBuilder.h"
-
-#include <charconv>
-#include <iomanip>
+#include <array>
+#include <limits>
 #include <unordered_map>
 
-#include "template_ternary.hpp"
-
+#include "compiler/jit_session.hpp"
 #include "compiler/kaleidoscope_jit.hpp"
+#include "compiler/numeric_literal.hpp"
 
 
-#define ADD_PRE_PASSES(fpm)                                \
-    fpm.add(llvm::createStraightLineStrengthReducePass()); \
-    fpm.add(llvm::createLoopRerollPass());                 \
-    fpm.add(llvm::createLoopUnrollPass(3));                \
-    fpm.add(llvm::createLoopUnrollAndJamPass(3));          \
-    fpm.add(llvm::createLoopRotatePass());                 \
-                                                           \
-    fpm.add(llvm::createLoopSimplifyCFGPass());            \
-    fpm.add(llvm::createLoopSimplifyPass());               \
-    fpm.add(llvm::createLICMPass());                       \
-    fpm.add(llvm::createLoopSinkPass());                   \
-    fpm.add(llvm::createLoopPredicationPass());            \
-    fpm.add(llvm::createLoopUnswitchPass());               \
-    fpm.add(llvm::createLoopInstSimplifyPass());           \
-                                                           \
-    fpm.add(llvm::createLoopVersioningLICMPass());         \
-    fpm.add(llvm::createLoopStrengthReducePass());         \
-    fpm.add(llvm::createLoopIdiomPass());                  \
-    fpm.add(llvm::createLoopDeletionPass());               \
-                                                           \
-    fpm.add(llvm::createCFGSimplificationPass());          \
-    fpm.add(llvm::createPromoteMemoryToRegisterPass());    \
-    fpm.add(llvm::createSeparateConstOffsetFromGEPPass()); \
-    fpm.add(llvm::createSROAPass());                       \
-                                                           \
-    fpm.add(llvm::createInstructionCombiningPass());       \
-    fpm.add(llvm::createReassociatePass());                \
-    fpm.add(llvm::createGVNPass());                        \
-                                                           \
-    fpm.add(llvm::createMergedLoadStoreMotionPass());
-
-
-#define ADD_POST_PASSES(fpm)                            \
-    fpm.add(llvm::createConstantHoistingPass());        \
-    fpm.add(llvm::createLowerConstantIntrinsicsPass()); \
-    fpm.add(llvm::createLoopSimplifyCFGPass());         \
-    fpm.add(llvm::createCFGSimplificationPass());       \
-                                                        \
-    fpm.add(llvm::createDeadStoreEliminationPass());    \
-    fpm.add(llvm::createDeadCodeEliminationPass());
-
 class Parser;
 
 
-void eat_function(Parser *parser) {
-    //    std::cout << "eat func";
-}
+void eat_function(Parser *parser);
 
 template<typename T>
-void emit_typename(Parser *parser) {
-    //    std::cout << "emit typename";
-}
+void emit_typename(Parser *parser);
 
 void emit_addition(Parser *parser);
+void emit_subtraction(Parser *parser);
+void emit_multiplication(Parser *parser);
+void emit_division(Parser *parser);
+void emit_negation(Parser *parser);
 
 using float64_t = double;
 using float32_t = float;
@@ -120,18 +75,31 @@ inline std::unordered_map<std::string_view, std::function<void(Parser *)>> &get_
     return KEYWORDS;
 }
 
-inline std::array<std::unordered_map<std::string_view, std::function<void(Parser *)>>, 2> &get_operators() {
-    static std::array<std::unordered_map<std::string_view, std::function<void(Parser *)>>, 2>
+struct OperatorInfo {
+    int precedence;// higher binds tighter
+    std::function<void(Parser *)> emit;
+};
+
+// operators are bucketed by length - 1 so that the longest match wins
+inline std::array<std::unordered_map<std::string_view, OperatorInfo>, 2> &get_operators() {
+    static std::array<std::unordered_map<std::string_view, OperatorInfo>, 2>
             OPERATORS =
                     {{{
-                              {"+", emit_addition},
-
+                              {"+", {1, emit_addition}},
+                              {"-", {1, emit_subtraction}},
+                              {"*", {2, emit_multiplication}},
+                              {"/", {2, emit_division}},
                       },
                       {}}};
 
     return OPERATORS;
 }
 
+// prefix minus; only recognized where an operand is expected
+inline const OperatorInfo &get_negation() {
+    static const OperatorInfo NEGATION = {3, emit_negation};
+    return NEGATION;
+}
 
 class Parser {
 public:
@@ -140,11 +108,12 @@ public:
     std::size_t line_no = 1;// this is synced with `ind`
 
     //    OperandStack operands;
-    std::vector<Value> operands;
+    std::vector<NodeIndex> operands;// expression nodes waiting for their operator
     //    std::vector<std::unique_ptr<Operator>> operators;
 
 
-    std::vector<std::size_t> lines;// input[lines[X]] is the beginning of line X+2.
+    Diagnostics diag;
+    bool panicking = false;// see emit_error()
 
     llvm::LLVMContext *ctx;
     std::unique_ptr<llvm::Module> module;
@@ -156,18 +125,36 @@ public:
     llvm::PassManagerBuilder pm_builder{};
     //    llvm::PassManager gpm;
 
-    explicit Parser(const std::string_view &inp, llvm::LLVMContext *ctx) : input(inp), ctx(ctx), module(std::make_unique<llvm::Module>("Module", *ctx)), builder(*ctx), fpm(module.get()) {
+    // Everything below is only used when compiling source (as opposed to brainfuck).
+    // Each `func` is parsed into `ast`, then lowered into its own module by `codegen`
+    // and handed to `session`. `ast` holds the whole compilation unit and is released in one go.
+    JITSession *session = nullptr;
 
-        pm_builder.OptLevel = 3;
-        pm_builder.SizeLevel = 2;
+    std::unique_ptr<TypeContext> own_types;// only when there is no session to borrow from
+    TypeContext *types;
 
-        ADD_PRE_PASSES(fpm)
+    Ast ast;
+    std::unique_ptr<CodeGen> codegen;
+    std::vector<NodeIndex> functions;// FUNCTION nodes, in source order
 
-        pm_builder.populateFunctionPassManager(fpm);
+    Type *cur_ret = nullptr;// return type of the function being parsed
+    bool cur_returns = false;// whether it has a return statement, even a broken one
 
-        ADD_POST_PASSES(fpm)
+    std::string_view decl_name;// name on the left of `= func`, set before the keyword is dispatched
+    bool in_body = false;      // between the '{' and '}' of the function being parsed
+    std::unordered_map<std::string_view, NodeIndex> locals;// parameter name -> PARAM node
 
-        fpm.doInitialization();
+    explicit Parser(const std::string_view &inp, llvm::LLVMContext *ctx, JITSession *session = nullptr) : input(inp), diag(inp), ctx(ctx), module(std::make_unique<llvm::Module>("Module", *ctx)), builder(*ctx), fpm(module.get()), session(session) {
+        if (session) {
+            types = &session->types;
+        } else {
+            own_types = std::make_unique<TypeContext>(ctx);
+            types = own_types.get();
+        }
+        codegen = std::make_unique<CodeGen>(ast, *types);
+
+        configure_pass_builder(pm_builder);
+        add_function_passes(fpm, pm_builder);
 
         // TODO: What the fuck are pointer address spaces? i'm just using getUnqual rn
         llvm::FunctionType *entry_point_signature = llvm::FunctionType::get(llvm::Type::getInt32Ty(*ctx), std::vector<llvm::Type *>{llvm::Type::getInt32Ty(*ctx), llvm::PointerType::getUnqual(llvm::Type::getInt8PtrTy(*ctx))}, false);
@@ -183,54 +170,26 @@ public:
     //        return nullptr;
     //    }
 
-    std::string_view get_line(std::size_t line) {
-        if (line - 2 >= lines.size())
-            return input;
-
-        std::size_t begin = line <= 1 ? 0 : lines[line - 2];
-
-        if (line - 1 >= lines.size())
-            return input.substr(begin);
-        return input.substr(begin, lines[line - 1]);
+    // Errors never unwind: they are recorded in `diag` and parsing carries on. Syntax errors
+    // also put the parser in panic mode, which silences follow-up errors until it resynchronizes
+    // at the next statement or bracket boundary. Functions that fail return NO_NODE / nullptr.
+    void emit_error(uint32_t begin, uint32_t end, const std::string &msg) {
+        if (!panicking)
+            diag.error({begin, std::max(end, begin + 1)}, msg);
     }
 
-    // binary search to find the line this index is on
-    [[nodiscard]] std::size_t lookup_line_no(std::size_t index) const {
-        if (lines.empty()) return 1;
-
-        std::size_t lo = 0;
-        std::size_t hi = lines.size() - 1;
-
-        while (lo <= hi) {
-            std::size_t mid = (lo + hi) / 2;
-            std::size_t val = lines[mid];
-
-            if (val > index) {
-                hi = mid - 1;
-            } else if (val < index) {
-                lo = mid + 1;
-            } else {
-                hi = mid;
-                break;
-            }
-        }
-
-        return hi + 2;
+    void emit_error(const std::string &msg) {
+        emit_error(static_cast<uint32_t>(ind), static_cast<uint32_t>(ind + 1), msg);
     }
 
-    inline void emit_error(const std::string &msg) {
-        //        auto line_no = lookup_line_no(ind);
-        std::cerr << "input[" << ind << "] (line " << line_no << "): " << msg << '\n';
-
-        constexpr std::size_t LINE_LENGTH_PRINT_THRESHOLD = 256;
-
-        std::string_view line = get_line(line_no);
-        if (line.size() >= LINE_LENGTH_PRINT_THRESHOLD)
-            std::cerr << '\t' << line.substr(line.size() - LINE_LENGTH_PRINT_THRESHOLD) << "...\n";
-        else
-            std::cerr << '\t' << line << '\n';
+    void syntax_error(const std::string &msg) {
+        emit_error(msg);
+        panicking = true;
+    }
 
-        throw std::runtime_error{msg};
+    void syntax_error(uint32_t begin, const std::string &msg) {
+        emit_error(begin, static_cast<uint32_t>(ind), msg);
+        panicking = true;
     }
 
 
@@ -251,12 +210,12 @@ public:
         return false;
     }
 
-    // loads the correct indices into `lines`
+    // loads the correct indices into `diag.lines`
     // this method touches ind, so it will need to be reset after calling
     void scan_lines() {
         while (ind < input.size()) {
             if (!consume_newline([&]() {
-                    lines.emplace_back(ind);
+                    diag.lines.emplace_back(ind);
                 }))
                 ind++;
         }
@@ -267,169 +226,677 @@ public:
             get_keywords()[sym](this);
     }
 
-    template<std::size_t byte_size>
-    inline void push_float(float64_t value) {
-        operands.emplace_back(Value{llvm::ConstantFP::get(*ctx, byte_size == 8 ? llvm::APFloat(value) : llvm::APFloat(static_cast<float32_t>(value))), get_type<FloatingPointType, byte_size>()});
-    }
+    // skips whitespace, newlines and `//` comments
+    void skip_whitespace() {
+        while (ind < input.size()) {
+            if (consume_newline([&]() { line_no++; }))
+                continue;
+
+            if (input.substr(ind, 2) == "//") {
+                while (ind < input.size() && input[ind] != '\n' && input[ind] != '\r')
+                    ind++;
+                continue;
+            }
 
-    // TODO: APInt and APFloat are pretty inelegant
-    template<std::size_t byte_size, bool is_signed>
-    inline void push_int(uint64_t value) {
-        // this code is so fucking cursed, and i love it
-        operands.emplace_back(Value{llvm::ConstantInt::get(*ctx, llvm::APInt(8 * byte_size, value, is_signed)), get_type<typename Ternary<is_signed, SignedIntegerType, UnsignedIntegerType>::value, byte_size>()});
+            if (!std::isspace(input[ind]))
+                return;
+            ind++;
+        }
     }
 
-    void handle_numeric_literal() {
-        uint64_t whole_part = 0;
+    static bool is_symbol_char(char c) {
+        return std::isalnum(c) || c == '_';
+    }
 
-        ind--;// ind already points to the start of the numeric literal
-        while (++ind < input.size() && std::isdigit(input[ind])) {
-            uint64_t old = whole_part;
-            whole_part *= 10;
-            whole_part += input[ind] - '0';
-            if (whole_part <= old)
-                emit_error("Numeric literal too large: Overflow detected in u64");
+    // empty if there is no identifier here
+    std::string_view eat_symbol() {
+        skip_whitespace();
+        if (ind >= input.size() || !(std::isalpha(input[ind]) || input[ind] == '_')) {
+            syntax_error("Expected an identifier");
+            return {};
         }
 
-        // float literal
-        if (ind < input.size() && input[ind] == '.') {
-            auto val = static_cast<float64_t>(whole_part);
+        std::size_t begin = ind;
+        while (++ind < input.size() && is_symbol_char(input[ind]))
+            ;
 
-            uint64_t pow = 10;
-            while (++ind < input.size() && std::isdigit(input[ind])) {
-                val += (input[ind] - '0') / static_cast<float64_t>(pow);
-                pow *= 10.0;
+        return input.substr(begin, ind - begin);
+    }
+
+    bool try_eat(const std::string_view &tok) {
+        skip_whitespace();
+        if (input.substr(ind, tok.size()) != tok)
+            return false;
+
+        ind += tok.size();
+        return true;
+    }
+
+    // like try_eat, but `tok` may not run into a longer identifier
+    bool try_eat_keyword(const std::string_view &tok) {
+        skip_whitespace();
+        if (input.substr(ind, tok.size()) != tok || (ind + tok.size() < input.size() && is_symbol_char(input[ind + tok.size()])))
+            return false;
+
+        ind += tok.size();
+        return true;
+    }
+
+    bool expect(const std::string_view &tok) {
+        if (try_eat(tok))
+            return true;
+
+        syntax_error("Expected '" + std::string{tok} + "'");
+        return false;
+    }
+
+    // Skips ahead to `close` at bracket depth 0 and consumes it, which ends panic mode.
+    // Gives up without consuming anything at a ';' or unbalanced '}' (left for the statement
+    // and function levels to recover at) or at the end of input.
+    bool recover_to(char close) {
+        int depth = 0;
+        while (true) {
+            skip_whitespace();
+            if (ind >= input.size())
+                return false;
+
+            char cur = input[ind];
+            if (depth == 0 && cur == close) {
+                ind++;
+                panicking = false;
+                return true;
             }
 
-            // I would use
-            // std::string_view res = input.substr(begin, ind - begin);
-            // auto err = std::from_chars(res.data(), res.data() + res.size(), val);
-            // but sadly it's not implemented :(
+            if (cur == '(' || cur == '[' || cur == '{') {
+                depth++;
+            } else if (cur == ')' || cur == ']' || cur == '}') {
+                if (depth == 0)
+                    return false;
+                depth--;
+            } else if (cur == ';' && depth == 0) {
+                return false;
+            }
 
-            std::cout << "got float: " << std::setprecision(100) << val << '\n';
+            ind++;
+        }
+    }
 
-            if (ind >= input.size()) return;
-            std::string_view type_lit = input.substr(ind, 3);// no risk of index out of bounds
+    // statement boundary: past the next ';', or up to (not including) the '}' closing the body
+    void synchronize_statement() {
+        while (!recover_to(';') && ind < input.size() && input[ind] != '}')
+            ind++;// stray ')' or ']'
+        panicking = false;
+    }
 
-            std::size_t orig_size = operands.size();
-            if (type_lit == "f64")
-                push_float<8>(val);
-            else if (type_lit == "f32")
-                push_float<4>(val);
+    // type := name ('*' | '[' integer ']')*
+    Type *eat_typename() {
+        skip_whitespace();
+        auto begin = static_cast<uint32_t>(ind);
+        std::string_view name = eat_symbol();
+        if (name.empty())
+            return nullptr;
+
+        Type *type = types->lookup(name);
+        if (!type) {
+            emit_error(begin, static_cast<uint32_t>(ind), "Unknown type '" + std::string{name} + "'");
+            return nullptr;
+        }
 
-            if (operands.size() != orig_size)
-                ind += 3;
-            else
-                push_float<8>(val);// default to f64 for no ending
+        while (true) {
+            if (try_eat("*")) {
+                type = types->pointer(type);
+            } else if (try_eat("[")) {
+                skip_whitespace();
+                NumericLiteral len = parse_numeric_literal(input.substr(ind));
+                if (len.error || len.is_float || len.length == 0) {
+                    syntax_error("Expected an array length");
+                    recover_to(']');
+                    return nullptr;
+                }
+                ind += len.length;
+                if (!expect("]"))
+                    return nullptr;
 
-            return;
+                if (type->is_void()) {
+                    emit_error(begin, static_cast<uint32_t>(ind), "Arrays of void are not allowed");
+                    return nullptr;
+                }
+                type = types->array(type, len.integer);
+            } else {
+                return type;
+            }
         }
+    }
 
-        std::cout << "got int: " << whole_part << '\n';
-
-        if (ind >= input.size()) return;
-        std::string_view type_lit = input.substr(ind, 3);
-        // turn this into a map probably
-
-        // used to detect if any cases succeeded. TODO: This is a terrible hack
-        std::size_t operands_size = operands.size();
-        if (type_lit == "i64")
-            push_int<8, true>(whole_part);
-        else if (type_lit == "i32")
-            push_int<4, true>(whole_part);
-        else if (type_lit == "i16")
-            push_int<2, true>(whole_part);
-        else if (type_lit == "i8")
-            push_int<1, true>(whole_part);
-        else if (type_lit == "u64")
-            push_int<8, false>(whole_part);
-        else if (type_lit == "u32")
-            push_int<4, false>(whole_part);
-        else if (type_lit == "u16")
-            push_int<2, false>(whole_part);
-        else if (type_lit == "u8")
-            push_int<1, false>(whole_part);
-        else if (type_lit == "f64")
-            push_float<8>(static_cast<float64_t>(whole_part));
-        else if (type_lit == "f32")
-            push_float<4>(static_cast<float64_t>(whole_part));
-
-        if (operands.size() != operands_size)
-            ind += 3;
-        else
-            push_int<4, true>(whole_part);// default i32 for no ending
-    }
-
-    llvm::Value *shunting_yard() {
+    // program := (name '=' 'func' ...)*
+    void parse_program() {
+        skip_whitespace();
         while (ind < input.size()) {
+            std::size_t start = ind;
+
+            in_body = false;
+            decl_name = eat_symbol();
+            if (!decl_name.empty() && expect("=")) {
+                skip_whitespace();
+                if (try_eat_keyword("func"))
+                    handle_symbol("func");
+                else
+                    syntax_error("Expected 'func' after '" + std::string{decl_name} + " ='");
+            }
+
+            if (panicking)
+                synchronize_declaration();
+            if (ind == start)
+                ind++;// never get stuck on the same character
+
+            skip_whitespace();
+        }
+    }
+
+    // Skips the rest of a broken declaration. Before its body, that is up to a ';' (consumed),
+    // the end of the line or the next `name = func`, unless a '{' comes first; from there, or
+    // from inside the body, it is through the '}' that closes the body.
+    void synchronize_declaration() {
+        while (!in_body && ind < input.size()) {
             char cur = input[ind];
+            if (cur == '\n' || cur == '\r' || input.substr(ind, 2) == "//" || at_declaration())
+                break;
+            ind++;
+            if (cur == ';')
+                break;
+            in_body = cur == '{';
+        }
 
-            if (consume_newline([&]() { line_no++; }))
-                continue;
+        if (in_body) {
+            recover_to('}');
+            while (panicking && ind < input.size()) {
+                ind++;// stopped at a ';' or stray bracket inside the body
+                recover_to('}');
+            }
+            in_body = false;
+        }
+        panicking = false;
+    }
 
-            if (std::isspace(cur)) {
-                ind++;
-                continue;
-            } else if (std::isdigit(cur)) {
-                // No support for 0x, 0b, or 0o
-                handle_numeric_literal();
-                continue;
-            } else if (std::isalpha(cur)) {
-                // symbol name
-                std::size_t begin = ind;
-                while (++ind < input.size() && std::isalnum(input[ind]))
-                    ;
-
-                std::string_view sym_name = input.substr(begin, ind - begin);
-                handle_symbol(sym_name);
-            } else {
-                for (int i = 1; i >= 0; i--) {
-                    std::string_view view = input.substr(ind, i + 1);
-                    if (get_operators()[i].count(view) > 0) {
-                        // ind now points to the last character of our operator,
-                        // and we rely on the later ind++; to increment it to the correct one
-                        ind += i;
-
-                        get_operators()[i][view](this);
+    // whether `name = func` starts here; consumes nothing
+    bool at_declaration() {
+        if (!(std::isalpha(input[ind]) || input[ind] == '_') || (ind > 0 && is_symbol_char(input[ind - 1])))
+            return false;
+
+        std::size_t saved_ind = ind, saved_line_no = line_no;
+        while (ind < input.size() && is_symbol_char(input[ind]))
+            ind++;
+        bool ret = try_eat("=") && try_eat_keyword("func");
+        ind = saved_ind;
+        line_no = saved_line_no;
+        return ret;
+    }
+
+    // '(' [type name (',' type name)*] ')' ['->' type] '{' statement* '}'
+    void function_definition() {
+        auto source = static_cast<uint32_t>(ind);
+        if (!session) {
+            syntax_error("Function definitions need a JIT session");
+            return;
+        }
+
+        std::size_t errors_before = diag.errors;
+        std::string name{decl_name};
+
+        std::vector<Type *> params;
+        std::vector<uint32_t> children;// parameter names, then statements
+
+        locals.clear();
+        if (!expect("("))
+            return;
+
+        if (!try_eat(")")) {
+            do {
+                auto begin = static_cast<uint32_t>(ind);
+                Type *param_type = eat_typename();
+                std::string_view param = eat_symbol();
+                if (panicking)
+                    break;
+
+                if (param_type && param_type->is_void()) {
+                    emit_error(begin, static_cast<uint32_t>(ind), "Parameters cannot be void");
+                    param_type = nullptr;
+                }
+
+                params.push_back(param_type);
+                children.push_back(ast.add_name(param));
+
+                NodeIndex node = param_type ? ast.add(NodeKind::PARAM, param_type, begin, static_cast<uint32_t>(params.size() - 1)) : NO_NODE;
+                if (!locals.emplace(param, node).second)
+                    emit_error(begin, static_cast<uint32_t>(ind), "Duplicate parameter '" + std::string{param} + "'");
+            } while (try_eat(","));
+
+            if (panicking ? !recover_to(')') : !expect(")"))
+                return;
+        }
+
+        Type *ret = types->void_type();
+        if (try_eat("->"))
+            ret = eat_typename();
+        if (panicking)
+            return;
+
+        // declared before the body so that it may call itself
+        bool valid_signature = ret && std::find(params.begin(), params.end(), nullptr) == params.end();
+        Type *signature = valid_signature ? types->function(ret, params) : nullptr;
+        if (signature && !session->declare(name, signature)) {
+            emit_error(source, source, "Redefinition of '" + name + "' changes its signature from " + session->functions[name].signature->to_string() + " to " + signature->to_string());
+            signature = nullptr;
+        }
+
+        cur_ret = ret;
+        cur_returns = false;
+
+        if (!expect("{"))
+            return;
+        in_body = true;
+
+        while (!try_eat("}")) {
+            if (ind >= input.size()) {
+                emit_error(source, source, "Function body of '" + name + "' is never closed");
+                return;
+            }
+
+            NodeIndex stmt = statement();
+            if (stmt != NO_NODE)
+                children.push_back(stmt);
+        }
+        in_body = false;
+
+        // there is no control flow (yet), so one return anywhere covers every path
+        if (ret && !cur_returns && !ret->is_void())
+            emit_error(source, source, "'" + name + "' must return a value of type " + ret->to_string());
+
+        locals.clear();
+
+        // a function with errors is still declared (if its signature was fine), but never compiled
+        if (!signature || diag.errors != errors_before)
+            return;
+
+        NodeIndex func = ast.add(NodeKind::FUNCTION, signature, source, ast.add_name(decl_name), ast.add_list(children));
+        functions.push_back(func);
+
+        compile_function(func);
+    }
+
+    // lowers a finished FUNCTION node and swaps it into the JIT
+    void compile_function(NodeIndex func) {
+        uint32_t source = ast[func].source;
+        std::string name{ast.names[ast[func].lhs]};
+        FunctionEntry &entry = session->functions.at(name);
+
+        std::unique_ptr<llvm::Module> fmodule = codegen->lower_function(func, entry.next_symbol(name), session->jit->getDataLayout());
+        if (!fmodule) {
+            emit_error(source, source, "Generated invalid IR for '" + name + "'");
+            return;
+        }
+
+        if (auto err = session->define(name, std::move(fmodule)))
+            emit_error(source, source, "Failed to compile '" + name + "': " + llvm::toString(std::move(err)));
+    }
+
+    // statement := 'return' [expression] ';' | expression ';'
+    // Returns NO_NODE if the statement had errors, after skipping past it.
+    NodeIndex statement() {
+        skip_whitespace();
+        auto source = static_cast<uint32_t>(ind);
+        std::size_t errors_before = diag.errors;
+
+        NodeIndex ret = NO_NODE;
+        if (try_eat_keyword("return")) {
+            if (try_eat(";")) {
+                cur_returns = true;
+                if (cur_ret && !cur_ret->is_void())
+                    emit_error(source, static_cast<uint32_t>(ind), "Expected a return value of type " + cur_ret->to_string());
+                return ast.add(NodeKind::RETURN, types->void_type(), source);
+            }
+
+            cur_returns = true;
+
+            NodeIndex val = expression();
+            if (!panicking && expect(";")) {
+                if (cur_ret && cur_ret->is_void())
+                    emit_error(source, static_cast<uint32_t>(ind), "Cannot return a value from a void function");
+                else if (cur_ret && val != NO_NODE)
+                    ret = ast.add(NodeKind::RETURN, types->void_type(), source, convert(val, cur_ret));
+            }
+        } else {
+            NodeIndex expr = expression();
+            if (!panicking && expect(";") && expr != NO_NODE)
+                ret = ast.add(NodeKind::EXPR_STMT, types->void_type(), source, expr);
+        }
+
+        if (panicking)
+            synchronize_statement();
+
+        return diag.errors == errors_before ? ret : NO_NODE;
+    }
+
+    // Shunting-yard over `operands`. Stops (without consuming) at anything that isn't
+    // an operator, so ';', ',' and ')' are left to the caller.
+    // Returns NO_NODE on error; semantic errors only poison the result, syntax errors also
+    // stop parsing the expression.
+    NodeIndex expression() {
+        std::size_t base = operands.size();
+        std::vector<const OperatorInfo *> pending;
+
+        bool want_operand = true;
+        while (!panicking) {
+            skip_whitespace();
+            if (ind >= input.size()) {
+                syntax_error("Unexpected end of input in expression");
+                break;
+            }
+
+            char cur = input[ind];
+            if (want_operand) {
+                if (std::isdigit(cur)) {
+                    handle_numeric_literal();
+                } else if (std::isalpha(cur) || cur == '_') {
+                    handle_operand_symbol(eat_symbol());
+                } else if (cur == '(') {
+                    ind++;
+                    NodeIndex inner = expression();
+                    if (panicking ? !recover_to(')') : !expect(")"))
                         break;
-                    }
+                    operands.push_back(inner);
+                } else if (cur == '-') {
+                    ind++;
+                    pending.push_back(&get_negation());
+                    continue;
+                } else {
+                    syntax_error("Expected an expression");
+                    break;
                 }
 
-                ind++;
+                want_operand = false;
                 continue;
             }
 
-            //            if (cur == 'x')
-            //                emit_error("test error");
+            const OperatorInfo *op = nullptr;
+            for (int i = 1; i >= 0 && !op; i--) {
+                auto it = get_operators()[i].find(input.substr(ind, i + 1));
+                if (it != get_operators()[i].end()) {
+                    op = &it->second;
+                    ind += i + 1;
+                }
+            }
 
-            ind++;
+            if (!op)
+                break;
+
+            while (!pending.empty() && pending.back()->precedence >= op->precedence) {
+                pending.back()->emit(this);
+                pending.pop_back();
+            }
+
+            pending.push_back(op);
+            want_operand = true;
+        }
+
+        if (panicking || operands.size() < base + 1) {
+            operands.resize(base);
+            return NO_NODE;
+        }
+
+        while (!pending.empty()) {
+            pending.back()->emit(this);
+            pending.pop_back();
+        }
+
+        NodeIndex ret = operands.back();
+        operands.resize(base);
+        return ret;
+    }
+
+    void handle_operand_symbol(const std::string_view &sym) {
+        auto begin = static_cast<uint32_t>(ind - sym.size());
+        if (sym.empty())
+            return;
+
+        if (sym == "func") {
+            syntax_error(begin, "Function definitions are only allowed at the top level");
+            return;
+        }
+
+        if (get_keywords().count(sym) != 0) {
+            handle_symbol(sym);
+            return;
+        }
+
+        if (try_eat("(")) {
+            emit_call(sym, begin);
+            return;
+        }
+
+        auto it = locals.find(sym);
+        if (it == locals.end())
+            emit_error(begin, static_cast<uint32_t>(ind), "Unknown variable '" + std::string{sym} + "'");
+        operands.push_back(it == locals.end() ? NO_NODE : it->second);// PARAM nodes have no children, so sharing them is fine
+    }
+
+    // called with the '(' already consumed
+    void emit_call(const std::string_view &sym, uint32_t begin) {
+        std::string name{sym};
+        Type *callee = nullptr;
+        if (session) {
+            auto it = session->functions.find(name);
+            if (it != session->functions.end())
+                callee = it->second.signature;
+        }
+
+        // arguments are parsed (and checked) even if the callee is unknown
+        std::vector<uint32_t> args;
+        bool poisoned = callee == nullptr;
+        if (!try_eat(")")) {
+            do {
+                NodeIndex arg = expression();
+                if (panicking)
+                    break;
+
+                if (callee && args.size() < callee->num_params)
+                    arg = convert(arg, callee->params[args.size()]);
+                poisoned |= arg == NO_NODE;
+                args.push_back(arg);
+            } while (try_eat(","));
+
+            if (panicking ? !recover_to(')') : !expect(")")) {
+                operands.push_back(NO_NODE);
+                return;
+            }
+        }
+
+        auto end = static_cast<uint32_t>(ind);
+        if (!callee) {
+            emit_error(begin, end, "Call to undefined function '" + name + "'");
+        } else if (args.size() != callee->num_params) {
+            emit_error(begin, end, "'" + name + "' expects " + std::to_string(callee->num_params) + " arguments, got " + std::to_string(args.size()));
+            poisoned = true;
+        }
+
+        operands.push_back(poisoned ? NO_NODE : ast.add(NodeKind::CALL, callee->element, begin, ast.add_name(sym), ast.add_list(args)));
+    }
+
+    // `type(expr)` conversion, entered through the typename keywords
+    void emit_cast(Type *type) {
+        if (!expect("(")) {
+            operands.push_back(NO_NODE);
+            return;
+        }
+
+        NodeIndex val = expression();
+        if (panicking ? !recover_to(')') : !expect(")"))
+            val = NO_NODE;
+
+        operands.push_back(convert(val, type));
+    }
+
+    NodeIndex pop_operand() {
+        NodeIndex val = operands.back();
+        operands.pop_back();
+        if (val != NO_NODE && ast[val].type->is_void()) {
+            emit_error(ast[val].source, ast[val].source, "Void value used in an expression");
+            return NO_NODE;
+        }
+        return val;
+    }
+
+    // wraps `val` in a CAST node if it isn't already of type `to`; NO_NODE stays NO_NODE
+    NodeIndex convert(NodeIndex val, Type *to) {
+        if (val == NO_NODE)
+            return NO_NODE;
+
+        Type *from = ast[val].type;
+        if (from == to)
+            return val;
+
+        uint32_t source = ast[val].source;
+        if (from->is_void()) {
+            emit_error(source, source, "Void value used in an expression");
+            return NO_NODE;
+        }
+        if (!(from->is_numeric() || from->is_bool()) || !(to->is_numeric() || to->is_bool())) {
+            emit_error(source, source, "Cannot convert " + from->to_string() + " to " + to->to_string());
+            return NO_NODE;
+        }
+
+        return ast.add(NodeKind::CAST, to, source, val);
+    }
+
+    // the usual arithmetic conversions, minus the promotion to int
+    static Type *common_type(Type *lhs, Type *rhs) {
+        if (lhs->is_float() || rhs->is_float()) {
+            if (lhs->is_float() && rhs->is_float())
+                return lhs->size >= rhs->size ? lhs : rhs;
+            return lhs->is_float() ? lhs : rhs;
+        }
+
+        if (lhs->size != rhs->size)
+            return lhs->size > rhs->size ? lhs : rhs;
+        return lhs->is_signed() ? rhs : lhs;
+    }
+
+    void emit_arithmetic(NodeKind op) {
+        NodeIndex rhs = pop_operand();
+        NodeIndex lhs = pop_operand();
+        if (lhs == NO_NODE || rhs == NO_NODE) {
+            operands.push_back(NO_NODE);
+            return;
+        }
+
+        Type *lt = ast[lhs].type;
+        Type *rt = ast[rhs].type;
+        if (!lt->is_numeric() || !rt->is_numeric()) {
+            emit_error(ast[lhs].source, ast[rhs].source, "Arithmetic on non-numeric types " + lt->to_string() + " and " + rt->to_string());
+            operands.push_back(NO_NODE);
+            return;
+        }
+
+        Type *type = common_type(lt, rt);
+        operands.push_back(ast.add(op, type, ast[lhs].source, convert(lhs, type), convert(rhs, type)));
+    }
+
+    void emit_negate() {
+        NodeIndex val = pop_operand();
+        if (val != NO_NODE && !ast[val].type->is_numeric()) {
+            emit_error(ast[val].source, ast[val].source, "Cannot negate a value of type " + ast[val].type->to_string());
+            val = NO_NODE;
         }
 
-        while (operands.size() >= 2) {
-            Value back = operands.back();
-            Value other = *(operands.end() - 2);
-            operands.pop_back();
-            operands.pop_back();
+        operands.push_back(val == NO_NODE ? NO_NODE : ast.add(NodeKind::NEGATE, ast[val].type, ast[val].source, val));
+    }
 
-            operands.emplace_back(Value{builder.CreateAdd(back.llvm, other.llvm), get_type<FloatingPointType, 8>()});
+    void push_literal(Type *type, const NumericLiteral &lit, uint32_t source) {
+        auto end = static_cast<uint32_t>(ind);
+        if (type->is_float()) {
+            double val = lit.is_float ? lit.floating : static_cast<double>(lit.integer);
+            operands.push_back(ast.add_float(type, source, val));
+            return;
         }
 
-        if (!operands.empty())
-            builder.CreateRet(operands.back().llvm);
+        if (lit.is_float) {
+            emit_error(source, end, "Floating point literal cannot have integer type " + type->to_string());
+            operands.push_back(NO_NODE);
+            return;
+        }
 
-        //        builder->CreateCast
+        // the literal itself is never negative; prefix minus is its own operator
+        std::size_t bits = 8 * type->size - (type->is_signed() ? 1 : 0);
+        if (bits < 64 && lit.integer >> bits != 0) {
+            emit_error(source, end, "Numeric literal " + std::to_string(lit.integer) + " does not fit in " + type->to_string());
+            operands.push_back(NO_NODE);
+            return;
+        }
 
-        llvm::verifyFunction(*main);
-        llvm::verifyModule(*module);
+        operands.push_back(ast.add_int(type, source, lit.integer));
+    }
 
-        module->print(llvm::outs(), nullptr);
+    // <literal>[suffix], e.g. 12, 0xFF_FFu16, 1.5e3f32, 1'000'000i64
+    void handle_numeric_literal() {
+        auto source = static_cast<uint32_t>(ind);
+        NumericLiteral lit = parse_numeric_literal(input.substr(ind));
+        ind += lit.length;
 
-        return nullptr;
+        std::size_t begin = ind;
+        while (ind < input.size() && is_symbol_char(input[ind]))
+            ind++;
+        std::string_view suffix = input.substr(begin, ind - begin);
+
+        if (lit.error) {
+            emit_error(source, static_cast<uint32_t>(ind), lit.error);
+            operands.push_back(NO_NODE);
+        } else if (!suffix.empty()) {
+            Type *type = types->lookup(suffix);
+            if (!type || !type->is_numeric()) {
+                emit_error(static_cast<uint32_t>(begin), static_cast<uint32_t>(ind), "Invalid numeric literal suffix '" + std::string{suffix} + "'");
+                operands.push_back(NO_NODE);
+            } else {
+                push_literal(type, lit, source);
+            }
+        } else if (lit.is_float) {
+            push_literal(types->floating(64), lit, source);
+        } else if (lit.integer <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+            push_literal(types->integer(32, true), lit, source);// default to i32 like before, widening only when it won't fit
+        } else if (lit.integer <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            push_literal(types->integer(64, true), lit, source);
+        } else {
+            push_literal(types->integer(64, false), lit, source);
+        }
     }
 
     void brainfuck();
 };
 
+void eat_function(Parser *parser) {
+    parser->function_definition();
+}
+
+template<typename T>
+void emit_typename(Parser *parser) {
+    parser->emit_cast(parser->types->of<T>());
+}
+
 void emit_addition(Parser *parser) {
-    std::cout << "plus operator\n";
-}
\ No newline at end of file
+    parser->emit_arithmetic(NodeKind::ADD);
+}
+
+void emit_subtraction(Parser *parser) {
+    parser->emit_arithmetic(NodeKind::SUB);
+}
+
+void emit_multiplication(Parser *parser) {
+    parser->emit_arithmetic(NodeKind::MUL);
+}
+
+void emit_division(Parser *parser) {
+    parser->emit_arithmetic(NodeKind::DIV);
+}
+
+void emit_negation(Parser *parser) {
+    parser->emit_negate();
+}
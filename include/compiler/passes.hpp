@@ -0,0 +1,69 @@
+#pragma once
+
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Utils.h"
+
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+
+
+#define ADD_PRE_PASSES(fpm)                                \
+    fpm.add(llvm::createStraightLineStrengthReducePass()); \
+    fpm.add(llvm::createLoopRerollPass());                 \
+    fpm.add(llvm::createLoopUnrollPass(3));                \
+    fpm.add(llvm::createLoopUnrollAndJamPass(3));          \
+    fpm.add(llvm::createLoopRotatePass());                 \
+                                                           \
+    fpm.add(llvm::createLoopSimplifyCFGPass());            \
+    fpm.add(llvm::createLoopSimplifyPass());               \
+    fpm.add(llvm::createLICMPass());                       \
+    fpm.add(llvm::createLoopSinkPass());                   \
+    fpm.add(llvm::createLoopPredicationPass());            \
+    fpm.add(llvm::createLoopUnswitchPass());               \
+    fpm.add(llvm::createLoopInstSimplifyPass());           \
+                                                           \
+    fpm.add(llvm::createLoopVersioningLICMPass());         \
+    fpm.add(llvm::createLoopStrengthReducePass());         \
+    fpm.add(llvm::createLoopIdiomPass());                  \
+    fpm.add(llvm::createLoopDeletionPass());               \
+                                                           \
+    fpm.add(llvm::createCFGSimplificationPass());          \
+    fpm.add(llvm::createPromoteMemoryToRegisterPass());    \
+    fpm.add(llvm::createSeparateConstOffsetFromGEPPass()); \
+    fpm.add(llvm::createSROAPass());                       \
+                                                           \
+    fpm.add(llvm::createInstructionCombiningPass());       \
+    fpm.add(llvm::createReassociatePass());                \
+    fpm.add(llvm::createGVNPass());                        \
+                                                           \
+    fpm.add(llvm::createMergedLoadStoreMotionPass());
+
+
+#define ADD_POST_PASSES(fpm)                            \
+    fpm.add(llvm::createConstantHoistingPass());        \
+    fpm.add(llvm::createLowerConstantIntrinsicsPass()); \
+    fpm.add(llvm::createLoopSimplifyCFGPass());         \
+    fpm.add(llvm::createCFGSimplificationPass());       \
+                                                        \
+    fpm.add(llvm::createDeadStoreEliminationPass());    \
+    fpm.add(llvm::createDeadCodeEliminationPass());
+
+
+inline void configure_pass_builder(llvm::PassManagerBuilder &pm_builder) {
+    pm_builder.OptLevel = 3;
+    pm_builder.SizeLevel = 2;
+}
+
+// the pipeline every generated function goes through
+inline void add_function_passes(llvm::legacy::FunctionPassManager &pm, llvm::PassManagerBuilder &pm_builder) {
+    ADD_PRE_PASSES(pm)
+
+    pm_builder.populateFunctionPassManager(pm);
+
+    ADD_POST_PASSES(pm)
+
+    pm.doInitialization();
+}
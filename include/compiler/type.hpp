@@ -1,44 +1,217 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Type.h"
+#include "llvm/Support/Allocator.h"
 
-class Type {
-public:
-    std::size_t size = 0; // size in bytes
 
-    explicit Type(std::size_t s) : size(s) {}
+enum class TypeKind : uint8_t {
+    VOID,
+    BOOL,
+    SIGNED,
+    UNSIGNED,
+    FLOAT,
+    POINTER,
+    ARRAY,
+    FUNCTION
 };
 
-class NumericType : public Type {
+// Types are interned by TypeContext, so two types are the same iff their pointers are equal.
+// Never construct one directly.
+class Type : public llvm::FoldingSetNode {
 public:
-    explicit NumericType(std::size_t s) : Type(s) {}
-};
+    TypeKind kind;
+    uint32_t size;// size in bytes; 0 for void and function types
 
-class FloatingPointType : public NumericType {
-public:
-    explicit FloatingPointType(std::size_t s) : NumericType(s) {}
-};
+    Type *element;// pointee, array element or return type
+    uint64_t count;// array length
 
-class IntegerType : public NumericType {
-public:
-    explicit IntegerType(std::size_t s) : NumericType(s) {}
+    Type *const *params;
+    uint32_t num_params;
+
+    llvm::Type *llvm = nullptr;// filled in on first TypeContext::lower()
+
+    Type(TypeKind kind, uint32_t size, Type *element, uint64_t count, Type *const *params, uint32_t num_params)
+        : kind(kind), size(size), element(element), count(count), params(params), num_params(num_params) {}
+
+    [[nodiscard]] bool is_void() const { return kind == TypeKind::VOID; }
+    [[nodiscard]] bool is_bool() const { return kind == TypeKind::BOOL; }
+    [[nodiscard]] bool is_float() const { return kind == TypeKind::FLOAT; }
+    [[nodiscard]] bool is_signed() const { return kind == TypeKind::SIGNED; }
+    [[nodiscard]] bool is_integer() const { return kind == TypeKind::SIGNED || kind == TypeKind::UNSIGNED; }
+    [[nodiscard]] bool is_numeric() const { return is_integer() || is_float(); }
+    [[nodiscard]] bool is_function() const { return kind == TypeKind::FUNCTION; }
+
+    [[nodiscard]] llvm::ArrayRef<Type *> param_types() const {
+        return {params, num_params};
+    }
+
+    static void profile(llvm::FoldingSetNodeID &id, TypeKind kind, uint32_t size, Type *element, uint64_t count, llvm::ArrayRef<Type *> params) {
+        id.AddInteger(static_cast<uint8_t>(kind));
+        id.AddInteger(size);
+        id.AddPointer(element);
+        id.AddInteger(count);
+        for (Type *param: params)
+            id.AddPointer(param);
+    }
+
+    void Profile(llvm::FoldingSetNodeID &id) const {
+        profile(id, kind, size, element, count, param_types());
+    }
+
+    // spelling used in the source language, for error messages
+    [[nodiscard]] std::string to_string() const {
+        switch (kind) {
+            case TypeKind::VOID:
+                return "void";
+            case TypeKind::BOOL:
+                return "bool";
+            case TypeKind::SIGNED:
+                return "i" + std::to_string(size * 8);
+            case TypeKind::UNSIGNED:
+                return "u" + std::to_string(size * 8);
+            case TypeKind::FLOAT:
+                return "f" + std::to_string(size * 8);
+            case TypeKind::POINTER:
+                return element->to_string() + "*";
+            case TypeKind::ARRAY:
+                return element->to_string() + "[" + std::to_string(count) + "]";
+            case TypeKind::FUNCTION: {
+                std::string ret = "func(";
+                for (uint32_t i = 0; i < num_params; i++)
+                    ret += (i > 0 ? ", " : "") + params[i]->to_string();
+                return ret + ") -> " + element->to_string();
+            }
+        }
+        return "<type>";
+    }
 };
 
-class SignedIntegerType : public IntegerType {
+// Owns every Type for one LLVMContext. Nodes (and their parameter lists) live in a bump
+// allocator and are all released together with the context.
+class TypeContext {
 public:
-    explicit SignedIntegerType(std::size_t s) : IntegerType(s) {}
-};
+    llvm::LLVMContext *ctx;
 
+    explicit TypeContext(llvm::LLVMContext *ctx) : ctx(ctx) {
+        names = {
+                {"i64", integer(64, true)},
+                {"i32", integer(32, true)},
+                {"i16", integer(16, true)},
+                {"i8", integer(8, true)},
 
-class UnsignedIntegerType : public IntegerType {
-public:
-    explicit UnsignedIntegerType(std::size_t s) : IntegerType(s) {}
-};
+                {"u64", integer(64, false)},
+                {"u32", integer(32, false)},
+                {"u16", integer(16, false)},
+                {"u8", integer(8, false)},
 
-template <typename T, std::size_t size>
-inline static Type *get_type() {
-    static std::unique_ptr<T> val = std::make_unique<T>(size);
-    return val.get();
-}
+                {"f64", floating(64)},
+                {"f32", floating(32)},
 
+                {"bool", boolean()},
+                {"void", void_type()}};
+    }
+
+    TypeContext(const TypeContext &) = delete;
+    TypeContext &operator=(const TypeContext &) = delete;
+
+    Type *void_type() { return get(TypeKind::VOID, 0); }
+    Type *boolean() { return get(TypeKind::BOOL, 1); }
+    Type *integer(uint32_t bits, bool is_signed) { return get(is_signed ? TypeKind::SIGNED : TypeKind::UNSIGNED, bits / 8); }
+    Type *floating(uint32_t bits) { return get(TypeKind::FLOAT, bits / 8); }
+
+    Type *pointer(Type *pointee) { return get(TypeKind::POINTER, 8, pointee); }
+    Type *array(Type *element, uint64_t count) { return get(TypeKind::ARRAY, static_cast<uint32_t>(element->size * count), element, count); }
+    Type *function(Type *ret, llvm::ArrayRef<Type *> params) { return get(TypeKind::FUNCTION, 0, ret, 0, params); }
+
+    // maps a C++ scalar onto the matching type
+    template<typename T>
+    Type *of() {
+        if constexpr (std::is_void_v<T>)
+            return void_type();
+        else if constexpr (std::is_same_v<T, bool>)
+            return boolean();
+        else if constexpr (std::is_floating_point_v<T>)
+            return floating(8 * sizeof(T));
+        else
+            return integer(8 * sizeof(T), std::is_signed_v<T>);
+    }
+
+    // builtin type names; nullptr if `name` isn't one
+    Type *lookup(std::string_view name) const {
+        auto it = names.find(name);
+        return it == names.end() ? nullptr : it->second;
+    }
+
+    llvm::Type *lower(Type *type) {
+        if (type->llvm)
+            return type->llvm;
+
+        switch (type->kind) {
+            case TypeKind::VOID:
+                type->llvm = llvm::Type::getVoidTy(*ctx);
+                break;
+            case TypeKind::BOOL:
+                type->llvm = llvm::Type::getInt1Ty(*ctx);
+                break;
+            case TypeKind::SIGNED:
+            case TypeKind::UNSIGNED:
+                type->llvm = llvm::Type::getIntNTy(*ctx, 8 * type->size);
+                break;
+            case TypeKind::FLOAT:
+                type->llvm = type->size == 8 ? llvm::Type::getDoubleTy(*ctx) : llvm::Type::getFloatTy(*ctx);
+                break;
+            case TypeKind::POINTER: {
+                llvm::Type *pointee = lower(type->element);
+                type->llvm = (pointee->isVoidTy() ? llvm::Type::getInt8Ty(*ctx) : pointee)->getPointerTo();
+                break;
+            }
+            case TypeKind::ARRAY:
+                type->llvm = llvm::ArrayType::get(lower(type->element), type->count);
+                break;
+            case TypeKind::FUNCTION: {
+                std::vector<llvm::Type *> params;
+                params.reserve(type->num_params);
+                for (Type *param: type->param_types())
+                    params.push_back(lower(param));
+                type->llvm = llvm::FunctionType::get(lower(type->element), params, false);
+                break;
+            }
+        }
+
+        return type->llvm;
+    }
+
+private:
+    llvm::BumpPtrAllocator arena;
+    llvm::FoldingSet<Type> interned;
+    std::unordered_map<std::string_view, Type *> names;
+
+    Type *get(TypeKind kind, uint32_t size, Type *element = nullptr, uint64_t count = 0, llvm::ArrayRef<Type *> params = {}) {
+        llvm::FoldingSetNodeID id;
+        Type::profile(id, kind, size, element, count, params);
+
+        void *insert_pos = nullptr;
+        if (Type *existing = interned.FindNodeOrInsertPos(id, insert_pos))
+            return existing;
+
+        Type **param_storage = nullptr;
+        if (!params.empty()) {
+            param_storage = arena.Allocate<Type *>(params.size());
+            std::copy(params.begin(), params.end(), param_storage);
+        }
+
+        Type *type = new (arena.Allocate<Type>()) Type(kind, size, element, count, param_storage, static_cast<uint32_t>(params.size()));
+        interned.InsertNode(type, insert_pos);
+        return type;
+    }
+};
@@ -1,5 +1,18 @@
-#include <functional>
+#pragma once
+
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+
+#include "lingalg/batch.hpp"
+#include "lingalg/elimination.hpp"
+#include "lingalg/expr.hpp"
+#include "lingalg/gemm.hpp"
+#include "lingalg/lu.hpp"
+#include "lingalg/view.hpp"
+
+template<typename T, unsigned N>
+class LU;
 
 template<typename T, unsigned R, unsigned C>
 class Matrix {
@@ -14,71 +27,68 @@ public:
 
     T dat[R][C];
 
-    T *operator[](unsigned r) { return dat[r]; }
-    T const *operator[](unsigned r) const { return dat[r]; }
+    constexpr T *operator[](unsigned r) { return dat[r]; }
+    constexpr T const *operator[](unsigned r) const { return dat[r]; }
 
-    T &operator()(unsigned r, unsigned c) { return dat[r][c]; }
+    constexpr T &operator()(unsigned r, unsigned c) { return dat[r][c]; }
 
-    T operator()(unsigned r, unsigned c) const { return dat[r][c]; }
+    constexpr T operator()(unsigned r, unsigned c) const { return dat[r][c]; }
 
-    self &operator+=(const self &rhs) {
-        for (unsigned r = 0; r < rows; r++)
-            for (unsigned c = 0; c < cols; c++)
-                dat[r][c] += rhs[r][c];
+    constexpr lingalg_detail::RowsView<T, C> view() { return {dat}; }
+    constexpr lingalg_detail::RowsView<const T, C> view() const { return {dat}; }
+
+    // evaluates an expression (see lingalg/expr.hpp) in one pass
+    template<typename E, typename = std::enable_if_t<lingalg_detail::is_mat_expr<E>>>
+    constexpr self &operator=(const E &rhs) {
+        lingalg_detail::assign<lingalg_detail::AssignOp>(*this, rhs);
         return *this;
     }
 
-    inline self operator+(const self &rhs) const {
-        return self{*this} += rhs;
+    template<typename E, typename = std::enable_if_t<lingalg_detail::is_mat_expr<E>>>
+    constexpr self &operator+=(const E &rhs) {
+        lingalg_detail::assign<lingalg_detail::AddAssignOp>(*this, rhs);
+        return *this;
     }
 
-    self &operator*=(T rhs) {
+    template<typename E, typename = std::enable_if_t<lingalg_detail::is_mat_expr<E>>>
+    constexpr self &operator-=(const E &rhs) {
+        lingalg_detail::assign<lingalg_detail::SubAssignOp>(*this, rhs);
+        return *this;
+    }
+
+    constexpr self &operator*=(T rhs) {
         for (unsigned r = 0; r < rows; r++)
             for (unsigned c = 0; c < cols; c++)
-                dat[r][c] *= rhs[r][c];
+                dat[r][c] *= rhs;
         return *this;
     }
 
-    inline self operator*(T rhs) const {
-        return self{*this} *= rhs;
-    }
+    constexpr T det() const;
+    constexpr self &invert();
 
-    template<unsigned O>
-    Matrix<T, R, O> operator*(const Matrix<T, C, O> &rhs) const {
-        Matrix<T, R, O> x{};
-        for (unsigned r = 0; r < R; r++)
-            for (unsigned c = 0; c < O; c++) {
-                x[r][c] = 0;
-                for (unsigned mr = 0; mr < C; mr++)
-                    x[r][c] += rhs[mr][c] * dat[r][mr];
-            }
-        return x;
-    }
+    constexpr LU<T, R> lu() const;
 
-    T det() const;
-    self &invert();
+    // solves *this * x = b
+    template<unsigned O>
+    constexpr Matrix<T, R, O> solve(const Matrix<T, R, O> &b) const;
 
-    self &ref();
-    self &rref();
+    constexpr self &ref();
+    constexpr self &rref();
 
-    inline self inverted() const {
+    constexpr self inverted() const {
         return self{*this}.invert();
     }
 
-    inline self rrefed() const {
+    constexpr self rrefed() const {
         return self{*this}.rref();
     }
 
-    inline self refed() const {
+    constexpr self refed() const {
         return self{*this}.ref();
     }
 
-    Matrix<T, C, R> transposed() const {
-        Matrix<T, C, R> x{};
-        for (unsigned r = 0; r < rows; r++)
-            for (unsigned c = 0; c < cols; c++)
-                x[c][r] = dat[r][c];
-        return x;
+    constexpr Matrix<T, C, R> transposed() const {
+        return transpose(*this);
     }
 
     std::string to_string() const {
@@ -91,7 +101,7 @@ public:
         return ret;
     }
 
-    void swap_rows(unsigned a, unsigned b) {
+    constexpr void swap_rows(unsigned a, unsigned b) {
         for (unsigned i = 0; i < cols; i++) {
             T tmp = dat[a][i];
             dat[a][i] = dat[b][i];
@@ -99,12 +109,13 @@ public:
         }
     }
 
-    void row_add_mult(unsigned src, unsigned dst, T mult) {
+    constexpr void row_add_mult(unsigned src, unsigned dst, T mult) {
         for (unsigned i = 0; i < cols; i++)
             dat[dst][i] += dat[src][i] * mult;
     }
 
-    void row_map(unsigned row, std::function<T(T)> map) {
+    template<typename F>
+    constexpr void row_map(unsigned row, F &&map) {
         for (unsigned i = 0; i < cols; i++)
             dat[row][i] = map(dat[row][i]);
     }
@@ -121,112 +132,105 @@ using Vec = Vector<double, S>;
 
 
 template<typename T, unsigned R, unsigned C>
-Matrix<T, R, C> &Matrix<T, R, C>::ref() {
-    static_assert(C >= R, "Gaussian Elimination may only be run on matrices with more columns than rows");
-
-    for (unsigned r = 0; r < rows; r++) {
-        unsigned c = r;
+constexpr Matrix<T, R, C> &Matrix<T, R, C>::ref() {
+    lingalg_detail::eliminate(view(), R, C, false);
+    return *this;
+}
 
-        {
-            unsigned use = r;
-            for (unsigned i = r + 1; i < rows; i++)
-                if (dat[i][c] > dat[use][c])
-                    use = i;
+template<typename T, unsigned R, unsigned C>
+constexpr Matrix<T, R, C> &Matrix<T, R, C>::rref() {
+    lingalg_detail::eliminate(view(), R, C, true);
+    return *this;
+}
 
-            if (dat[use][c] == 0)
-                continue;// skip row if 0
+template<unsigned RA, unsigned CA, unsigned RB, unsigned CB, typename T>
+constexpr typename std::enable_if<(RA == 1 || CA == 1) && (RB == 1 || CB == 1), T>::type dot(const Matrix<T, RA, CA> &a, const Matrix<T, RB, CB> &b) {
+    static_assert(RA * CA == RB * CB, "can only dot() vectors of the same length");
 
-            if (use != r)
-                swap_rows(use, r);
-        }// this code is questionable; I probably shouldn't be doing this greedily!
+    T ret = 0;
+    for (unsigned i = 0; i < RA * CA; i++)
+        ret += (RA == 1 ? a(0, i) : a(i, 0)) * (RB == 1 ? b(0, i) : b(i, 0));
+    return ret;
+}
 
-        row_map(r, [&, div{dat[r][c]}](T in) { return in / div; });
+// A factorization P*A = L*U of a square matrix. Factor once with Matrix::lu(), then solve()
+// against as many right-hand sides as needed for O(N^2) each.
+template<typename T, unsigned N>
+class LU {
+public:
+    Matrix<T, N, N> lu;// L strictly below the diagonal, U on and above it
+    unsigned perm[N]{};// row i of P*A is row perm[i] of A
+    int sign = 0;      // determinant of P, or 0 if A is singular
 
-        for (unsigned mr = r + 1; mr < rows; mr++)
-            row_add_mult(r, mr, -dat[mr][c] / dat[r][c]);
+    constexpr explicit LU(const Matrix<T, N, N> &a) : lu(a) {
+        sign = lingalg_detail::lu_factor(lu.view(), N, perm);
     }
 
-    return *this;
-}
+    [[nodiscard]] constexpr bool singular() const { return sign == 0; }
 
-template<typename T, unsigned R, unsigned C>
-Matrix<T, R, C> &Matrix<T, R, C>::rref() {
-    ref();
+    constexpr T det() const {
+        T ret = sign;
+        for (unsigned i = 0; i < N; i++)
+            ret *= lu[i][i];
+        return ret;
+    }
 
-    for (unsigned r = rows - 1; r >= 0; r--) {
-        unsigned c = r;
+    template<unsigned O>
+    constexpr Matrix<T, N, O> solve(const Matrix<T, N, O> &b) const {
+        if (singular())
+            throw std::runtime_error{"Singular matrix"};
 
-        for (unsigned mr = 0; mr < r; mr++)
-            row_add_mult(r, mr, -dat[mr][c] / dat[r][c]);
+        Matrix<T, N, O> x{};
+        lingalg_detail::lu_solve(lu.view(), N, perm, b.view(), x.view(), O);
+        return x;
     }
 
-    return *this;
-}
+    constexpr Matrix<T, N, N> inverse() const {
+        Matrix<T, N, N> id{};
+        for (unsigned i = 0; i < N; i++)
+            id[i][i] = 1;
+        return solve(id);
+    }
+};
 
 template<typename T, unsigned R, unsigned C>
-Matrix<T, R, C> &Matrix<T, R, C>::invert() {
-    static_assert(R == C, "Can only invert square matrices");
-
-    Matrix<T, R, C * 2> st;
-    for (unsigned r = 0; r < R; r++)
-        for (unsigned c = 0; c < C; c++) {
-            st[r][c] = dat[r][c];
-            st[r][C + c] = r == c ? 1 : 0;
-        }
-
-    st = st.rref();
-
-    for (unsigned r = 0; r < R; r++)
-        for (unsigned c = 0; c < C; c++) {
-            dat[r][c] = st[r][C + c];
-            if (st[r][c] != (r == c ? 1 : 0))// raw float equality?
-                throw std::runtime_error{"Singular matrix"};
-        }
-
-    return *this;
+constexpr LU<T, R> Matrix<T, R, C>::lu() const {
+    static_assert(R == C, "can only factor square matrices");
+    return LU<T, R>{*this};
 }
 
-template<unsigned RA, unsigned CA, unsigned RB, unsigned CB, typename T>
-typename std::enable_if<RA == RB && (RA == 1 || CA == 1) && (RB == 1 || CB == 1), T>::type dot(const Matrix<T, RA, CA> &a, const Matrix<T, RB, CB> &b) {
-    return (a.transposed() * b)[0][0];
+template<typename T, unsigned R, unsigned C>
+template<unsigned O>
+constexpr Matrix<T, R, O> Matrix<T, R, C>::solve(const Matrix<T, R, O> &b) const {
+    return lu().solve(b);
 }
 
-template<unsigned RA, unsigned CA, unsigned RB, unsigned CB, typename T>
-typename std::enable_if<RA != RB && (RA == 1 || CA == 1) && (RB == 1 || CB == 1), T>::type dot(const Matrix<T, RA, CA> &a, const Matrix<T, RB, CB> &b) {
-    return (a * b)[0][0];
-}
+template<typename T, unsigned R, unsigned C>
+constexpr Matrix<T, R, C> &Matrix<T, R, C>::invert() {
+    static_assert(R == C, "Can only invert square matrices");
 
-constexpr inline unsigned umax(unsigned a, unsigned b) {
-    return a > b ? a : b;
+    self inv{*this};
+    unsigned swaps[R]{};
+    if (!lingalg_detail::gauss_jordan_invert(inv.view(), R, swaps))
+        throw std::runtime_error{"Singular matrix"};
+    return *this = inv;
 }
 
 template<typename T, unsigned R, unsigned C>
-T Matrix<T, R, C>::det() const {
+constexpr T Matrix<T, R, C>::det() const {
     static_assert(R == C, "can only det() square matrices");
 
-    if constexpr (R == 1 && C == 1)
+    if constexpr (R == 1)
         return dat[0][0];
-    else if constexpr (R == 2 && C == 1)
+    else if constexpr (R == 2)
         return dat[0][0] * dat[1][1] - dat[1][0] * dat[0][1];
-
-
-    T ret = 0;
-    int flip = 1;
-
-    // laplace expansion time!
-    for (unsigned c = 0; c < cols; c++) {
-        Matrix<T, umax(R - 1, 1), umax(C - 1, 1)> sub;
-
-        for (unsigned cr = 1; cr < rows; cr++) {
-            for (unsigned cc = 0; cc < c; cc++)
-                sub[cr - 1][cc] = dat[cr][cc];
-            for (unsigned cc = c + 1; cc < cols; cc++)
-                sub[cr - 1][cc - 1] = dat[cr][cc];
-        }
-
-        ret += flip * dat[0][c] * sub.det();
-        flip *= -1;
-    }
-
-    return ret;
-}
\ No newline at end of file
+    else if constexpr (R == 3)
+        return dat[0][0] * (dat[1][1] * dat[2][2] - dat[1][2] * dat[2][1])
+             - dat[0][1] * (dat[1][0] * dat[2][2] - dat[1][2] * dat[2][0])
+             + dat[0][2] * (dat[1][0] * dat[2][1] - dat[1][1] * dat[2][0]);
+    else if constexpr (std::is_integral_v<T>) {
+        self tmp{*this};
+        return lingalg_detail::det_bareiss(tmp.view(), R);
+    } else
+        return lu().det();
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstddef>
+
+#include "lingalg/elimination.hpp"
+
+// Batched inversion and solving of many small NxN systems at once.
+//
+// Batches are stored as structure-of-arrays: entry (r, c) of matrix i lives at
+// a[(r * N + c) * count + i], and entry r of vector i at b[r * count + i]. Every loop below
+// runs innermost over the batch, so it is contiguous and vectorizes no matter which pivot
+// each matrix picks; per-matrix pivoting is done with selects instead of branches.
+//
+// Matrices are processed in blocks of BATCH_BLOCK so that the bookkeeping lives on the stack.
+
+namespace lingalg_detail {
+
+constexpr std::size_t BATCH_BLOCK = 64;
+
+// Per-lane partial pivot search in column k, starting at row k. Also flags lanes whose best
+// pivot is below their tolerance and swaps row k with the pivot row in every lane.
+template<typename T, unsigned N>
+void batch_pivot(T *a, T *b, std::size_t count, std::size_t lanes, unsigned k,
+                 const T *tol, unsigned *piv, bool *singular) {
+    T best[BATCH_BLOCK];
+    for (std::size_t l = 0; l < lanes; l++) {
+        best[l] = magnitude(a[(k * N + k) * count + l]);
+        piv[l] = k;
+    }
+
+    for (unsigned i = k + 1; i < N; i++) {
+        const T *col = a + (i * N + k) * count;
+        for (std::size_t l = 0; l < lanes; l++) {
+            T m = magnitude(col[l]);
+            bool better = m > best[l];
+            best[l] = better ? m : best[l];
+            piv[l] = better ? i : piv[l];
+        }
+    }
+
+    for (std::size_t l = 0; l < lanes; l++)
+        singular[l] = singular[l] || best[l] <= tol[l];
+
+    for (unsigned i = k + 1; i < N; i++) {
+        for (unsigned c = 0; c < N; c++) {
+            T *x = a + (k * N + c) * count;
+            T *y = a + (i * N + c) * count;
+            for (std::size_t l = 0; l < lanes; l++) {
+                bool swap = piv[l] == i;
+                T xv = x[l], yv = y[l];
+                x[l] = swap ? yv : xv;
+                y[l] = swap ? xv : yv;
+            }
+        }
+
+        if (b) {
+            T *x = b + k * count;
+            T *y = b + i * count;
+            for (std::size_t l = 0; l < lanes; l++) {
+                bool swap = piv[l] == i;
+                T xv = x[l], yv = y[l];
+                x[l] = swap ? yv : xv;
+                y[l] = swap ? xv : yv;
+            }
+        }
+    }
+
+    // keep singular lanes finite; their results are garbage either way
+    T *diag = a + (k * N + k) * count;
+    for (std::size_t l = 0; l < lanes; l++)
+        diag[l] = singular[l] ? T{1} : diag[l];
+}
+
+template<typename T, unsigned N>
+void batch_tolerance(const T *a, std::size_t count, std::size_t lanes, T *tol) {
+    for (std::size_t l = 0; l < lanes; l++)
+        tol[l] = 0;
+    for (unsigned e = 0; e < N * N; e++)
+        for (std::size_t l = 0; l < lanes; l++) {
+            T m = magnitude(a[e * count + l]);
+            tol[l] = m > tol[l] ? m : tol[l];
+        }
+    for (std::size_t l = 0; l < lanes; l++)
+        tol[l] = pivot_tolerance(tol[l], N);
+}
+
+// Gauss-Jordan on one block of `lanes` matrices, see gauss_jordan_invert()
+template<typename T, unsigned N>
+void batch_invert_block(T *a, std::size_t count, std::size_t lanes, bool *singular) {
+    T tol[BATCH_BLOCK];
+    unsigned piv[N][BATCH_BLOCK];
+    batch_tolerance<T, N>(a, count, lanes, tol);
+
+    for (unsigned k = 0; k < N; k++) {
+        batch_pivot<T, N>(a, nullptr, count, lanes, k, tol, piv[k], singular);
+
+        T inv[BATCH_BLOCK];
+        T *diag = a + (k * N + k) * count;
+        for (std::size_t l = 0; l < lanes; l++) {
+            inv[l] = T{1} / diag[l];
+            diag[l] = 1;
+        }
+        for (unsigned c = 0; c < N; c++) {
+            T *x = a + (k * N + c) * count;
+            for (std::size_t l = 0; l < lanes; l++)
+                x[l] *= inv[l];
+        }
+
+        for (unsigned i = 0; i < N; i++) {
+            if (i == k)
+                continue;
+
+            T f[BATCH_BLOCK];
+            T *ik = a + (i * N + k) * count;
+            for (std::size_t l = 0; l < lanes; l++) {
+                f[l] = ik[l];
+                ik[l] = 0;
+            }
+            for (unsigned c = 0; c < N; c++) {
+                T *x = a + (i * N + c) * count;
+                const T *y = a + (k * N + c) * count;
+                for (std::size_t l = 0; l < lanes; l++)
+                    x[l] -= f[l] * y[l];
+            }
+        }
+    }
+
+    // undo the row swaps as column swaps, in reverse
+    for (unsigned k = N; k-- > 0;)
+        for (unsigned j = k + 1; j < N; j++)
+            for (unsigned r = 0; r < N; r++) {
+                T *x = a + (r * N + k) * count;
+                T *y = a + (r * N + j) * count;
+                for (std::size_t l = 0; l < lanes; l++) {
+                    bool swap = piv[k][l] == j;
+                    T xv = x[l], yv = y[l];
+                    x[l] = swap ? yv : xv;
+                    y[l] = swap ? xv : yv;
+                }
+            }
+}
+
+// Gaussian elimination and back substitution on one block of `lanes` systems
+template<typename T, unsigned N>
+void batch_solve_block(T *a, T *b, std::size_t count, std::size_t lanes, bool *singular) {
+    T tol[BATCH_BLOCK];
+    unsigned piv[BATCH_BLOCK];
+    batch_tolerance<T, N>(a, count, lanes, tol);
+
+    for (unsigned k = 0; k < N; k++) {
+        batch_pivot<T, N>(a, b, count, lanes, k, tol, piv, singular);
+
+        const T *diag = a + (k * N + k) * count;
+        for (unsigned i = k + 1; i < N; i++) {
+            T f[BATCH_BLOCK];
+            const T *ik = a + (i * N + k) * count;
+            for (std::size_t l = 0; l < lanes; l++)
+                f[l] = ik[l] / diag[l];
+
+            for (unsigned c = k + 1; c < N; c++) {
+                T *x = a + (i * N + c) * count;
+                const T *y = a + (k * N + c) * count;
+                for (std::size_t l = 0; l < lanes; l++)
+                    x[l] -= f[l] * y[l];
+            }
+            for (std::size_t l = 0; l < lanes; l++)
+                b[i * count + l] -= f[l] * b[k * count + l];
+        }
+    }
+
+    for (unsigned i = N; i-- > 0;) {
+        T *x = b + i * count;
+        for (unsigned c = i + 1; c < N; c++) {
+            const T *u = a + (i * N + c) * count;
+            const T *y = b + c * count;
+            for (std::size_t l = 0; l < lanes; l++)
+                x[l] -= u[l] * y[l];
+        }
+        const T *diag = a + (i * N + i) * count;
+        for (std::size_t l = 0; l < lanes; l++)
+            x[l] /= diag[l];
+    }
+}
+
+}// namespace lingalg_detail
+
+// Inverts `count` NxN matrices in place. singular[i] is set for every matrix that could not
+// be inverted (its entries are then unspecified) and cleared for all others.
+template<typename T, unsigned N>
+void batch_invert(T *a, std::size_t count, bool *singular) {
+    for (std::size_t i = 0; i < count; i++)
+        singular[i] = false;
+
+    for (std::size_t i = 0; i < count; i += lingalg_detail::BATCH_BLOCK) {
+        std::size_t lanes = count - i < lingalg_detail::BATCH_BLOCK ? count - i : lingalg_detail::BATCH_BLOCK;
+        lingalg_detail::batch_invert_block<T, N>(a + i, count, lanes, singular + i);
+    }
+}
+
+// Solves a_i * x_i = b_i for `count` systems. The solutions replace b and a is destroyed.
+template<typename T, unsigned N>
+void batch_solve(T *a, T *b, std::size_t count, bool *singular) {
+    for (std::size_t i = 0; i < count; i++)
+        singular[i] = false;
+
+    for (std::size_t i = 0; i < count; i += lingalg_detail::BATCH_BLOCK) {
+        std::size_t lanes = count - i < lingalg_detail::BATCH_BLOCK ? count - i : lingalg_detail::BATCH_BLOCK;
+        lingalg_detail::batch_solve_block<T, N>(a + i, b + i, count, lanes, singular + i);
+    }
+}
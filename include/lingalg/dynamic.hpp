@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lingalg.hpp"
+
+namespace lingalg_detail {
+
+constexpr std::size_t DYN_ALIGN = 64;// a cache line, and enough for any vector load
+
+template<typename T>
+constexpr std::size_t padded_stride(std::size_t cols) {
+    constexpr std::size_t per_line = DYN_ALIGN / sizeof(T) > 0 ? DYN_ALIGN / sizeof(T) : 1;
+    return (cols + per_line - 1) / per_line * per_line;
+}
+
+template<typename T>
+T dot(const T *a, const T *b, std::size_t n) {
+    T ret = 0;
+    for (std::size_t i = 0; i < n; i++)
+        ret += a[i] * b[i];
+    return ret;
+}
+
+}// namespace lingalg_detail
+
+// A matrix whose size is only known at runtime. Rows are stored on the heap, each padded
+// to a whole number of cache lines and aligned to one, so that every row starts aligned and
+// large matrices don't end up on the stack. All algorithms are the ones Matrix uses.
+template<typename T>
+class DynMatrix {
+    static_assert(std::is_arithmetic_v<T>, "DynMatrix stores plain numbers");
+
+public:
+    typedef T type;
+    typedef DynMatrix<T> self;
+
+    DynMatrix() = default;
+
+    // zero-initialized
+    DynMatrix(std::size_t rows, std::size_t cols) : r(rows), c(cols), ld(lingalg_detail::padded_stride<T>(cols)) {
+        if (r * ld == 0)
+            return;
+
+        dat = static_cast<T *>(std::aligned_alloc(lingalg_detail::DYN_ALIGN, r * ld * sizeof(T)));
+        if (!dat)
+            throw std::bad_alloc{};
+        for (std::size_t i = 0; i < r * ld; i++)
+            dat[i] = 0;
+    }
+
+    template<unsigned R, unsigned C>
+    explicit DynMatrix(const Matrix<T, R, C> &m) : DynMatrix(R, C) {
+        for (unsigned i = 0; i < R; i++)
+            for (unsigned j = 0; j < C; j++)
+                (*this)[i][j] = m[i][j];
+    }
+
+    DynMatrix(const self &rhs) : DynMatrix(rhs.r, rhs.c) {
+        for (std::size_t i = 0; i < r * ld; i++)
+            dat[i] = rhs.dat[i];
+    }
+
+    DynMatrix(self &&rhs) noexcept : r(rhs.r), c(rhs.c), ld(rhs.ld), dat(rhs.dat) {
+        rhs.r = rhs.c = rhs.ld = 0;
+        rhs.dat = nullptr;
+    }
+
+    self &operator=(self rhs) noexcept {
+        std::swap(r, rhs.r);
+        std::swap(c, rhs.c);
+        std::swap(ld, rhs.ld);
+        std::swap(dat, rhs.dat);
+        return *this;
+    }
+
+    ~DynMatrix() {
+        std::free(dat);
+    }
+
+    static self identity(std::size_t n) {
+        self ret{n, n};
+        for (std::size_t i = 0; i < n; i++)
+            ret[i][i] = 1;
+        return ret;
+    }
+
+    [[nodiscard]] std::size_t rows() const { return r; }
+    [[nodiscard]] std::size_t cols() const { return c; }
+    [[nodiscard]] std::size_t stride() const { return ld; }// in elements, between the starts of two rows
+
+    T *data() { return dat; }
+    const T *data() const { return dat; }
+
+    lingalg_detail::StridedView<T> view() { return {dat, ld}; }
+    lingalg_detail::StridedView<const T> view() const { return {dat, ld}; }
+
+    T *operator[](std::size_t row) { return dat + row * ld; }
+    T const *operator[](std::size_t row) const { return dat + row * ld; }
+
+    T &operator()(std::size_t row, std::size_t col) { return dat[row * ld + col]; }
+    T operator()(std::size_t row, std::size_t col) const { return dat[row * ld + col]; }
+
+    // throws unless the sizes match
+    template<unsigned R, unsigned C>
+    Matrix<T, R, C> to_fixed() const {
+        require(r == R && c == C, "to_fixed() size mismatch");
+
+        Matrix<T, R, C> ret;
+        for (unsigned i = 0; i < R; i++)
+            for (unsigned j = 0; j < C; j++)
+                ret[i][j] = (*this)[i][j];
+        return ret;
+    }
+
+    self &operator+=(const self &rhs) {
+        require(r == rhs.r && c == rhs.c, "dimension mismatch");
+        for (std::size_t i = 0; i < r * ld; i++)
+            dat[i] += rhs.dat[i];// padding is zero on both sides
+        return *this;
+    }
+
+    self &operator-=(const self &rhs) {
+        require(r == rhs.r && c == rhs.c, "dimension mismatch");
+        for (std::size_t i = 0; i < r * ld; i++)
+            dat[i] -= rhs.dat[i];
+        return *this;
+    }
+
+    self &operator*=(T rhs) {
+        for (std::size_t i = 0; i < r * ld; i++)
+            dat[i] *= rhs;
+        return *this;
+    }
+
+    self operator+(const self &rhs) const { return self{*this} += rhs; }
+    self operator-(const self &rhs) const { return self{*this} -= rhs; }
+    self operator*(T rhs) const { return self{*this} *= rhs; }
+
+    self operator*(const self &rhs) const {
+        require(c == rhs.r, "dimension mismatch");
+
+        self ret{r, rhs.c};
+        lingalg_detail::gemm<T>(r, rhs.c, c, dat, ld, rhs.dat, rhs.ld, ret.dat, ret.ld);
+        return ret;
+    }
+
+    template<unsigned S>
+    Vector<T, S> operator*(const Vector<T, S> &rhs) const {
+        require(r == S && c == S, "dimension mismatch");
+
+        Vector<T, S> ret;
+        for (unsigned i = 0; i < S; i++)
+            ret[i][0] = lingalg_detail::dot((*this)[i], rhs.dat[0], S);
+        return ret;
+    }
+
+    std::vector<T> operator*(const std::vector<T> &rhs) const {
+        require(c == rhs.size(), "dimension mismatch");
+
+        std::vector<T> ret(r);
+        for (std::size_t i = 0; i < r; i++)
+            ret[i] = lingalg_detail::dot((*this)[i], rhs.data(), c);
+        return ret;
+    }
+
+    self transposed() const {
+        self ret{c, r};
+        for (std::size_t i = 0; i < r; i++)
+            for (std::size_t j = 0; j < c; j++)
+                ret[j][i] = (*this)[i][j];
+        return ret;
+    }
+
+    T det() const {
+        require(r == c, "can only det() square matrices");
+        if (r == 0)
+            return 1;
+
+        self tmp{*this};
+        if constexpr (std::is_integral_v<T>) {
+            return lingalg_detail::det_bareiss(tmp.view(), r);
+        } else {
+            std::vector<unsigned> perm(r);
+            T ret = lingalg_detail::lu_factor(tmp.view(), r, perm.data());
+            for (std::size_t i = 0; i < r; i++)
+                ret *= tmp[i][i];
+            return ret;
+        }
+    }
+
+    self &invert() {
+        require(r == c, "Can only invert square matrices");
+
+        std::vector<unsigned> swaps(r);
+        self inv{*this};
+        if (!lingalg_detail::gauss_jordan_invert(inv.view(), r, swaps.data()))
+            throw std::runtime_error{"Singular matrix"};
+        return *this = std::move(inv);
+    }
+
+    // solves *this * x = b
+    self solve(const self &b) const {
+        require(r == c && b.r == r, "dimension mismatch");
+
+        self lu{*this};
+        std::vector<unsigned> perm(r);
+        if (lingalg_detail::lu_factor(lu.view(), r, perm.data()) == 0)
+            throw std::runtime_error{"Singular matrix"};
+
+        self x{b.r, b.c};
+        lingalg_detail::lu_solve(lu.view(), r, perm.data(), b.view(), x.view(), b.c);
+        return x;
+    }
+
+    std::vector<T> solve(const std::vector<T> &b) const {
+        self col{b.size(), 1};
+        for (std::size_t i = 0; i < b.size(); i++)
+            col[i][0] = b[i];
+
+        self x = solve(col);
+        std::vector<T> ret(x.r);
+        for (std::size_t i = 0; i < x.r; i++)
+            ret[i] = x[i][0];
+        return ret;
+    }
+
+    self &ref() {
+        lingalg_detail::eliminate(view(), r, c, false);
+        return *this;
+    }
+
+    self &rref() {
+        lingalg_detail::eliminate(view(), r, c, true);
+        return *this;
+    }
+
+    inline self inverted() const {
+        return self{*this}.invert();
+    }
+
+    inline self rrefed() const {
+        return self{*this}.rref();
+    }
+
+    inline self refed() const {
+        return self{*this}.ref();
+    }
+
+    std::string to_string() const {
+        std::string ret = "";
+        for (std::size_t i = 0; i < r; i++) {
+            for (std::size_t j = 0; j < c; j++)
+                ret += std::to_string((*this)[i][j]) + "\t";
+            ret += "\n";
+        }
+        return ret;
+    }
+
+private:
+    std::size_t r = 0;
+    std::size_t c = 0;
+    std::size_t ld = 0;
+    T *dat = nullptr;
+
+    static void require(bool cond, const char *what) {
+        if (!cond)
+            throw std::invalid_argument{what};
+    }
+};
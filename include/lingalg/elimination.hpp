@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include "lingalg/lu.hpp"
+
+// Gaussian and Gauss-Jordan elimination behind Matrix::ref(), rref() and invert(), over a
+// view (see view.hpp).
+namespace lingalg_detail {
+
+// Pivots at or below this magnitude are treated as zero. Rounding error in elimination
+// grows with the size and the magnitude of the entries, so the cutoff scales with both.
+template<typename T>
+constexpr T pivot_tolerance(T scale, std::size_t n) {
+    if constexpr (std::is_floating_point_v<T>)
+        return scale * static_cast<T>(n) * std::numeric_limits<T>::epsilon();
+    else
+        return 0;
+}
+
+template<typename M>
+constexpr typename M::type max_magnitude(M a, std::size_t rows, std::size_t cols) {
+    typename M::type ret = 0;
+    for (std::size_t r = 0; r < rows; r++)
+        for (std::size_t c = 0; c < cols; c++)
+            if (magnitude(a(r, c)) > ret)
+                ret = magnitude(a(r, c));
+    return ret;
+}
+
+template<typename M>
+constexpr void swap_rows(M a, std::size_t cols, std::size_t x, std::size_t y) {
+    for (std::size_t c = 0; c < cols; c++) {
+        typename M::type tmp = a(x, c);
+        a(x, c) = a(y, c);
+        a(y, c) = tmp;
+    }
+}
+
+// Brings a into row echelon form with leading ones, or reduced row echelon form if `reduced`.
+// Columns without a usable pivot are skipped, so any shape and rank works. Returns the rank.
+template<typename M>
+constexpr std::size_t eliminate(M a, std::size_t rows, std::size_t cols, bool reduced) {
+    using T = typename M::type;
+    T tol = pivot_tolerance(max_magnitude(a, rows, cols), rows > cols ? rows : cols);
+
+    std::size_t r = 0;
+    for (std::size_t c = 0; c < cols && r < rows; c++) {
+        std::size_t pivot = r;
+        for (std::size_t i = r + 1; i < rows; i++)
+            if (magnitude(a(i, c)) > magnitude(a(pivot, c)))
+                pivot = i;
+
+        if (magnitude(a(pivot, c)) <= tol) {
+            for (std::size_t i = r; i < rows; i++)
+                a(i, c) = 0;// only noise left in this column
+            continue;
+        }
+
+        if (pivot != r)
+            swap_rows(a, cols, pivot, r);
+
+        T div = a(r, c);
+        a(r, c) = 1;
+        for (std::size_t j = c + 1; j < cols; j++)
+            a(r, j) /= div;
+
+        for (std::size_t i = reduced ? 0 : r + 1; i < rows; i++) {
+            if (i == r)
+                continue;
+
+            T f = a(i, c);
+            a(i, c) = 0;
+            for (std::size_t j = c + 1; j < cols; j++)
+                a(i, j) -= f * a(r, j);
+        }
+
+        r++;
+    }
+
+    return r;
+}
+
+// In-place Gauss-Jordan inversion with partial pivoting. The row swaps are recorded and
+// undone as column swaps at the end, so no augmented matrix is needed. `swaps` has room for
+// n entries. Returns false (leaving a garbage) if a is singular.
+template<typename M>
+constexpr bool gauss_jordan_invert(M a, std::size_t n, unsigned *swaps) {
+    using T = typename M::type;
+    T tol = pivot_tolerance(max_magnitude(a, n, n), n);
+
+    for (std::size_t k = 0; k < n; k++) {
+        std::size_t pivot = k;
+        for (std::size_t i = k + 1; i < n; i++)
+            if (magnitude(a(i, k)) > magnitude(a(pivot, k)))
+                pivot = i;
+
+        if (magnitude(a(pivot, k)) <= tol)
+            return false;
+
+        swaps[k] = static_cast<unsigned>(pivot);
+        if (pivot != k)
+            swap_rows(a, n, pivot, k);
+
+        T inv = T{1} / a(k, k);
+        a(k, k) = 1;
+        for (std::size_t j = 0; j < n; j++)
+            a(k, j) *= inv;
+
+        for (std::size_t i = 0; i < n; i++) {
+            if (i == k)
+                continue;
+
+            T f = a(i, k);
+            a(i, k) = 0;
+            for (std::size_t j = 0; j < n; j++)
+                a(i, j) -= f * a(k, j);
+        }
+    }
+
+    for (std::size_t k = n; k-- > 0;)
+        if (swaps[k] != k)
+            for (std::size_t r = 0; r < n; r++) {
+                T tmp = a(r, k);
+                a(r, k) = a(r, swaps[k]);
+                a(r, swaps[k]) = tmp;
+            }
+
+    return true;
+}
+
+}// namespace lingalg_detail
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <type_traits>
+
+#include "lingalg/gemm.hpp"
+
+template<typename T, unsigned R, unsigned C>
+class Matrix;
+
+// Expression templates for Matrix arithmetic. Element-wise operators, scaling, negation and
+// transposition build lightweight nodes, and the whole tree is evaluated in a single loop
+// when it is assigned to a Matrix, so `A + B * s - transpose(C)` makes no temporaries.
+//
+// Nodes hold Matrix operands by reference and other nodes by value, so an expression must
+// not outlive the matrices it mentions: assign it (or call eval()) within the statement
+// that builds it, and don't keep one in an `auto` variable.
+//
+// Matrix products are not element-wise: an element of A*B costs a whole dot product. A
+// product is therefore only evaluated as a whole, with the kernels from gemm.hpp, either
+// directly into its destination (`D = A*B`, `D += A*B`) or into a temporary when it is
+// an operand of a larger expression.
+namespace lingalg_detail {
+
+struct MatExprTag {};
+
+// Base of all expression nodes. E provides `T operator()(unsigned r, unsigned c) const` and
+// `bool refers(const void *m) const`, whether it reads Matrix m at all, and
+// `bool reorders(const void *m) const`, whether it reads m at other positions than the one
+// being written, which makes evaluating straight into m unsafe.
+template<typename E, typename T, unsigned R, unsigned C>
+class MatExpr : public MatExprTag {
+public:
+    typedef T type;
+    constexpr static unsigned rows = R;
+    constexpr static unsigned cols = C;
+
+    constexpr Matrix<T, R, C> eval() const {
+        Matrix<T, R, C> ret{};
+        ret = static_cast<const E &>(*this);
+        return ret;
+    }
+
+    constexpr operator Matrix<T, R, C>() const {
+        return eval();
+    }
+};
+
+template<typename E>
+struct is_matrix : std::false_type {};
+
+template<typename T, unsigned R, unsigned C>
+struct is_matrix<Matrix<T, R, C>> : std::true_type {};
+
+template<typename E>
+constexpr bool is_mat_expr = is_matrix<E>::value || std::is_base_of_v<MatExprTag, E>;
+
+template<typename A, typename B>
+class MatProduct;
+
+template<typename E>
+struct is_product : std::false_type {};
+
+template<typename A, typename B>
+struct is_product<MatProduct<A, B>> : std::true_type {};
+
+template<typename E>
+using evaluated_t = Matrix<typename E::type, E::rows, E::cols>;
+
+// how an element-wise node holds its operand E
+template<typename E>
+struct expr_storage {
+    using type = const E;
+};
+
+template<typename T, unsigned R, unsigned C>
+struct expr_storage<Matrix<T, R, C>> {
+    using type = const Matrix<T, R, C> &;
+};
+
+template<typename A, typename B>
+struct expr_storage<MatProduct<A, B>> {
+    using type = const evaluated_t<MatProduct<A, B>>;
+};
+
+template<typename E>
+using expr_storage_t = typename expr_storage<E>::type;
+
+// how a product holds its operand E: the kernels need real storage
+template<typename E>
+using product_storage_t = std::conditional_t<is_matrix<E>::value, const E &, const evaluated_t<E>>;
+
+template<typename T, unsigned R, unsigned C>
+constexpr bool expr_refers(const Matrix<T, R, C> &m, const void *p) {
+    return &m == p;
+}
+
+template<typename E>
+constexpr bool expr_refers(const E &e, const void *p) {
+    return e.refers(p);
+}
+
+template<typename T, unsigned R, unsigned C>
+constexpr bool expr_reorders(const Matrix<T, R, C> &, const void *) {
+    return false;
+}
+
+template<typename E>
+constexpr bool expr_reorders(const E &e, const void *p) {
+    return e.reorders(p);
+}
+
+struct AddOp {
+    template<typename T>
+    constexpr static T apply(T a, T b) { return a + b; }
+};
+
+struct SubOp {
+    template<typename T>
+    constexpr static T apply(T a, T b) { return a - b; }
+};
+
+struct MulOp {
+    template<typename T>
+    constexpr static T apply(T a, T b) { return a * b; }
+};
+
+template<typename Op, typename A, typename B>
+class MatBinary : public MatExpr<MatBinary<Op, A, B>, typename A::type, A::rows, A::cols> {
+public:
+    expr_storage_t<A> a;
+    expr_storage_t<B> b;
+
+    constexpr MatBinary(const A &a, const B &b) : a(a), b(b) {}
+
+    constexpr typename A::type operator()(unsigned r, unsigned c) const {
+        return Op::apply(a(r, c), b(r, c));
+    }
+
+    constexpr bool refers(const void *p) const { return expr_refers(a, p) || expr_refers(b, p); }
+    constexpr bool reorders(const void *p) const { return expr_reorders(a, p) || expr_reorders(b, p); }
+};
+
+template<typename A>
+class MatScale : public MatExpr<MatScale<A>, typename A::type, A::rows, A::cols> {
+public:
+    expr_storage_t<A> a;
+    typename A::type s;
+
+    constexpr MatScale(const A &a, typename A::type s) : a(a), s(s) {}
+
+    constexpr typename A::type operator()(unsigned r, unsigned c) const {
+        return a(r, c) * s;
+    }
+
+    constexpr bool refers(const void *p) const { return expr_refers(a, p); }
+    constexpr bool reorders(const void *p) const { return expr_reorders(a, p); }
+};
+
+template<typename A>
+class MatNegate : public MatExpr<MatNegate<A>, typename A::type, A::rows, A::cols> {
+public:
+    expr_storage_t<A> a;
+
+    constexpr explicit MatNegate(const A &a) : a(a) {}
+
+    constexpr typename A::type operator()(unsigned r, unsigned c) const {
+        return -a(r, c);
+    }
+
+    constexpr bool refers(const void *p) const { return expr_refers(a, p); }
+    constexpr bool reorders(const void *p) const { return expr_reorders(a, p); }
+};
+
+template<typename A>
+class MatTranspose : public MatExpr<MatTranspose<A>, typename A::type, A::cols, A::rows> {
+public:
+    expr_storage_t<A> a;
+
+    constexpr explicit MatTranspose(const A &a) : a(a) {}
+
+    constexpr typename A::type operator()(unsigned r, unsigned c) const {
+        return a(c, r);
+    }
+
+    constexpr bool refers(const void *p) const { return expr_refers(a, p); }
+    constexpr bool reorders(const void *p) const { return expr_refers(a, p); }
+};
+
+template<typename A, typename B>
+class MatProduct : public MatExpr<MatProduct<A, B>, typename A::type, A::rows, B::cols> {
+public:
+    using T = typename A::type;
+    constexpr static unsigned R = A::rows;
+    constexpr static unsigned K = A::cols;
+    constexpr static unsigned O = B::cols;
+
+    product_storage_t<A> a;
+    product_storage_t<B> b;
+
+    constexpr MatProduct(const A &a, const B &b) : a(a), b(b) {}
+
+    constexpr bool refers(const void *p) const { return expr_refers(a, p) || expr_refers(b, p); }
+    constexpr bool reorders(const void *p) const { return refers(p); }
+
+    // dst = a * b; dst must not be a or b
+    constexpr void assign_to(Matrix<T, R, O> &dst) const {
+        multiply(a.dat, b.dat, dst.dat);
+    }
+
+    // dst += a * b; dst must not be a or b
+    constexpr void add_to(Matrix<T, R, O> &dst) const {
+        if (LINGALG_CONSTANT_EVALUATED() || (R <= 4 && K <= 4 && O <= 4)) {
+            T tmp[R][O]{};
+            multiply(a.dat, b.dat, tmp);
+            for (unsigned r = 0; r < R; r++)
+                for (unsigned c = 0; c < O; c++)
+                    dst.dat[r][c] += tmp[r][c];
+        } else {
+            gemm<T>(R, O, K, a.dat[0], K, b.dat[0], O, dst.dat[0], O);
+        }
+    }
+};
+
+struct AssignOp {
+    template<typename T>
+    constexpr static void apply(T &d, T s) { d = s; }
+};
+
+struct AddAssignOp {
+    template<typename T>
+    constexpr static void apply(T &d, T s) { d += s; }
+};
+
+struct SubAssignOp {
+    template<typename T>
+    constexpr static void apply(T &d, T s) { d -= s; }
+};
+
+// dst op= e, in one pass unless e reads dst out of place
+template<typename Op, typename T, unsigned R, unsigned C, typename E>
+constexpr void assign(Matrix<T, R, C> &dst, const E &e) {
+    static_assert(E::rows == R && E::cols == C, "dimension mismatch");
+
+    if constexpr (is_product<E>::value) {
+        if (!e.refers(&dst) && std::is_same_v<Op, AssignOp>) {
+            e.assign_to(dst);
+            return;
+        }
+        if (!e.refers(&dst) && std::is_same_v<Op, AddAssignOp>) {
+            e.add_to(dst);
+            return;
+        }
+    } else if constexpr (!is_matrix<E>::value) {
+        if (!e.reorders(&dst)) {
+            for (unsigned r = 0; r < R; r++)
+                for (unsigned c = 0; c < C; c++)
+                    Op::apply(dst.dat[r][c], e(r, c));
+            return;
+        }
+    }
+
+    Matrix<T, R, C> tmp{};
+    assign<AssignOp>(tmp, e);
+    for (unsigned r = 0; r < R; r++)
+        for (unsigned c = 0; c < C; c++)
+            Op::apply(dst.dat[r][c], tmp.dat[r][c]);
+}
+
+}// namespace lingalg_detail
+
+template<typename A, typename B, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A> && lingalg_detail::is_mat_expr<B>>>
+constexpr auto operator+(const A &a, const B &b) {
+    static_assert(A::rows == B::rows && A::cols == B::cols, "dimension mismatch");
+    return lingalg_detail::MatBinary<lingalg_detail::AddOp, A, B>{a, b};
+}
+
+template<typename A, typename B, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A> && lingalg_detail::is_mat_expr<B>>>
+constexpr auto operator-(const A &a, const B &b) {
+    static_assert(A::rows == B::rows && A::cols == B::cols, "dimension mismatch");
+    return lingalg_detail::MatBinary<lingalg_detail::SubOp, A, B>{a, b};
+}
+
+template<typename A, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A>>>
+constexpr auto operator-(const A &a) {
+    return lingalg_detail::MatNegate<A>{a};
+}
+
+template<typename A, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A>>>
+constexpr auto operator*(const A &a, typename A::type s) {
+    return lingalg_detail::MatScale<A>{a, s};
+}
+
+template<typename A, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A>>>
+constexpr auto operator*(typename A::type s, const A &a) {
+    return lingalg_detail::MatScale<A>{a, s};
+}
+
+template<typename A, typename B, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A> && lingalg_detail::is_mat_expr<B>>>
+constexpr auto operator*(const A &a, const B &b) {
+    static_assert(A::cols == B::rows, "dimension mismatch");
+    return lingalg_detail::MatProduct<A, B>{a, b};
+}
+
+// element-wise product
+template<typename A, typename B, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A> && lingalg_detail::is_mat_expr<B>>>
+constexpr auto hadamard(const A &a, const B &b) {
+    static_assert(A::rows == B::rows && A::cols == B::cols, "dimension mismatch");
+    return lingalg_detail::MatBinary<lingalg_detail::MulOp, A, B>{a, b};
+}
+
+// transposed view, see Matrix::transposed() for a copy
+template<typename A, typename = std::enable_if_t<lingalg_detail::is_mat_expr<A>>>
+constexpr auto transpose(const A &a) {
+    return lingalg_detail::MatTranspose<A>{a};
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "lingalg/view.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define LINGALG_AVX2 1
+#endif
+
+// Matrix multiplication kernels behind Matrix::operator*. Everything is row-major.
+namespace lingalg_detail {
+
+template<std::size_t... I, typename F>
+constexpr void unroll_impl(F &&f, std::index_sequence<I...>) {
+    (f(std::integral_constant<std::size_t, I>{}), ...);
+}
+
+template<std::size_t N, typename F>
+constexpr void unroll(F &&f) {
+    unroll_impl(f, std::make_index_sequence<N>{});
+}
+
+template<std::size_t... I, typename F>
+constexpr auto unroll_sum_impl(F &&f, std::index_sequence<I...>) {
+    return (f(std::integral_constant<std::size_t, I>{}) + ...);
+}
+
+template<std::size_t N, typename F>
+constexpr auto unroll_sum(F &&f) {
+    return unroll_sum_impl(f, std::make_index_sequence<N>{});
+}
+
+#ifdef LINGALG_AVX2
+template<typename T>
+struct Simd;
+
+template<>
+struct Simd<double> {
+    using reg = __m256d;
+    constexpr static std::size_t width = 4;
+
+    static reg zero() { return _mm256_setzero_pd(); }
+    static reg load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, reg v) { _mm256_storeu_pd(p, v); }
+    static reg broadcast(double v) { return _mm256_set1_pd(v); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+};
+
+template<>
+struct Simd<float> {
+    using reg = __m256;
+    constexpr static std::size_t width = 8;
+
+    static reg zero() { return _mm256_setzero_ps(); }
+    static reg load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, reg v) { _mm256_storeu_ps(p, v); }
+    static reg broadcast(float v) { return _mm256_set1_ps(v); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+};
+
+template<typename T>
+constexpr bool has_simd = std::is_same_v<T, double> || std::is_same_v<T, float>;
+#else
+template<typename T>
+constexpr bool has_simd = false;
+#endif
+
+// Register block of the micro-kernel: GEMM_MR rows of C by gemm_nr<T>() columns.
+constexpr std::size_t GEMM_MR = 4;
+
+template<typename T>
+constexpr std::size_t gemm_nr() {
+#ifdef LINGALG_AVX2
+    if constexpr (has_simd<T>)
+        return 2 * Simd<T>::width;
+#endif
+    return std::max<std::size_t>(2, 32 / sizeof(T));
+}
+
+// Cache tiles: a GEMM_KC x GEMM_NC panel of B is reused by every row block of A, so it
+// should stay in L2; the GEMM_MR x GEMM_KC sliver of A streamed per micro-kernel fits in L1.
+constexpr std::size_t GEMM_KC = 128;
+constexpr std::size_t GEMM_NC = 256;
+
+// c[GEMM_MR][NR] += a[GEMM_MR][k] * b[k][NR]
+template<typename T>
+inline void micro_kernel(const T *a, std::size_t lda, const T *b, std::size_t ldb, T *c, std::size_t ldc, std::size_t k) {
+    constexpr std::size_t NR = gemm_nr<T>();
+
+#ifdef LINGALG_AVX2
+    if constexpr (has_simd<T>) {
+        using V = Simd<T>;
+        typename V::reg acc[GEMM_MR][2];
+        for (std::size_t r = 0; r < GEMM_MR; r++)
+            acc[r][0] = acc[r][1] = V::zero();
+
+        for (std::size_t p = 0; p < k; p++) {
+            typename V::reg b0 = V::load(b + p * ldb);
+            typename V::reg b1 = V::load(b + p * ldb + V::width);
+            for (std::size_t r = 0; r < GEMM_MR; r++) {
+                typename V::reg av = V::broadcast(a[r * lda + p]);
+                acc[r][0] = V::fma(av, b0, acc[r][0]);
+                acc[r][1] = V::fma(av, b1, acc[r][1]);
+            }
+        }
+
+        for (std::size_t r = 0; r < GEMM_MR; r++) {
+            V::store(c + r * ldc, V::add(V::load(c + r * ldc), acc[r][0]));
+            V::store(c + r * ldc + V::width, V::add(V::load(c + r * ldc + V::width), acc[r][1]));
+        }
+        return;
+    }
+#endif
+
+    T acc[GEMM_MR][NR] = {};
+    for (std::size_t p = 0; p < k; p++)
+        for (std::size_t r = 0; r < GEMM_MR; r++) {
+            T av = a[r * lda + p];
+            for (std::size_t j = 0; j < NR; j++)
+                acc[r][j] += av * b[p * ldb + j];
+        }
+
+    for (std::size_t r = 0; r < GEMM_MR; r++)
+        for (std::size_t j = 0; j < NR; j++)
+            c[r * ldc + j] += acc[r][j];
+}
+
+// partial blocks at the bottom and right edges
+template<typename T>
+inline void edge_kernel(const T *a, std::size_t lda, const T *b, std::size_t ldb, T *c, std::size_t ldc,
+                        std::size_t mr, std::size_t nr, std::size_t k) {
+    for (std::size_t r = 0; r < mr; r++)
+        for (std::size_t p = 0; p < k; p++) {
+            T av = a[r * lda + p];
+            for (std::size_t j = 0; j < nr; j++)
+                c[r * ldc + j] += av * b[p * ldb + j];
+        }
+}
+
+// c[m][n] += a[m][k] * b[k][n], with leading dimensions (row strides) lda, ldb and ldc
+template<typename T>
+void gemm(std::size_t m, std::size_t n, std::size_t k,
+          const T *a, std::size_t lda, const T *b, std::size_t ldb, T *c, std::size_t ldc) {
+    constexpr std::size_t NR = gemm_nr<T>();
+
+    for (std::size_t kk = 0; kk < k; kk += GEMM_KC) {
+        std::size_t kc = std::min(GEMM_KC, k - kk);
+
+        for (std::size_t jj = 0; jj < n; jj += GEMM_NC) {
+            std::size_t nc = std::min(GEMM_NC, n - jj);
+
+            for (std::size_t i = 0; i < m; i += GEMM_MR) {
+                std::size_t mr = std::min(GEMM_MR, m - i);
+
+                for (std::size_t j = jj; j < jj + nc; j += NR) {
+                    std::size_t nr = std::min(NR, jj + nc - j);
+
+                    const T *ap = a + i * lda + kk;
+                    const T *bp = b + kk * ldb + j;
+                    T *cp = c + i * ldc + j;
+                    if (mr == GEMM_MR && nr == NR)
+                        micro_kernel(ap, lda, bp, ldb, cp, ldc, kc);
+                    else
+                        edge_kernel(ap, lda, bp, ldb, cp, ldc, mr, nr, kc);
+                }
+            }
+        }
+    }
+}
+
+// Fully unrolled product for operands of at most 4x4. Each row of the result is a
+// combination of the rows of b, which maps onto one vector register when a row is 4 wide.
+template<typename T, unsigned R, unsigned K, unsigned O>
+inline void multiply_small(const T (&a)[R][K], const T (&b)[K][O], T (&c)[R][O]) {
+#ifdef LINGALG_AVX2
+    if constexpr (O == 4 && std::is_same_v<T, double>) {
+        __m256d rows[K];
+        unroll<K>([&](auto p) { rows[p] = _mm256_loadu_pd(b[p]); });
+        unroll<R>([&](auto r) {
+            __m256d acc = _mm256_mul_pd(_mm256_set1_pd(a[r][0]), rows[0]);
+            unroll<K - 1>([&](auto p) { acc = _mm256_fmadd_pd(_mm256_set1_pd(a[r][p + 1]), rows[p + 1], acc); });
+            _mm256_storeu_pd(c[r], acc);
+        });
+        return;
+    } else if constexpr (O == 4 && std::is_same_v<T, float>) {
+        __m128 rows[K];
+        unroll<K>([&](auto p) { rows[p] = _mm_loadu_ps(b[p]); });
+        unroll<R>([&](auto r) {
+            __m128 acc = _mm_mul_ps(_mm_set1_ps(a[r][0]), rows[0]);
+            unroll<K - 1>([&](auto p) { acc = _mm_fmadd_ps(_mm_set1_ps(a[r][p + 1]), rows[p + 1], acc); });
+            _mm_storeu_ps(c[r], acc);
+        });
+        return;
+    }
+#endif
+
+    unroll<R>([&](auto r) {
+        unroll<O>([&](auto j) {
+            c[r][j] = unroll_sum<K>([&](auto p) { return a[r][p] * b[p][j]; });
+        });
+    });
+}
+
+// c = a * b; picks a kernel from the dimensions at compile time
+template<typename T, unsigned R, unsigned K, unsigned O>
+constexpr void multiply(const T (&a)[R][K], const T (&b)[K][O], T (&c)[R][O]) {
+    if (LINGALG_CONSTANT_EVALUATED()) {
+        for (unsigned r = 0; r < R; r++)
+            for (unsigned j = 0; j < O; j++) {
+                T sum = 0;
+                for (unsigned p = 0; p < K; p++)
+                    sum += a[r][p] * b[p][j];
+                c[r][j] = sum;
+            }
+    } else if constexpr (R <= 4 && K <= 4 && O <= 4) {
+        multiply_small(a, b, c);
+    } else {
+        for (unsigned r = 0; r < R; r++)
+            for (unsigned j = 0; j < O; j++)
+                c[r][j] = 0;
+        gemm<T>(R, O, K, a[0], K, b[0], O, c[0], O);
+    }
+}
+
+}// namespace lingalg_detail
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+
+#include "lingalg/view.hpp"
+
+// LU factorization kernels behind Matrix::det(), invert() and solve(). They work in place on
+// a view (see view.hpp), so any square block of memory can be factored.
+namespace lingalg_detail {
+
+template<typename T>
+constexpr T magnitude(T x) {
+    return x < 0 ? -x : x;
+}
+
+// One step of LU: eliminates column k from rows [begin, end) using row k as the pivot row,
+// leaving the multipliers in column k. Rows are independent of each other.
+template<typename M>
+constexpr void lu_eliminate_rows(M a, std::size_t n, std::size_t k, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++) {
+        typename M::type l = a(i, k) /= a(k, k);
+        for (std::size_t j = k + 1; j < n; j++)
+            a(i, j) -= l * a(k, j);
+    }
+}
+
+// Swaps rows to bring the largest entry of column k (from row k down) onto the diagonal.
+// Returns false, without swapping, if the whole column is zero.
+template<typename M>
+constexpr bool lu_pivot(M a, std::size_t n, std::size_t k, unsigned *perm, int &sign) {
+    std::size_t pivot = k;
+    for (std::size_t i = k + 1; i < n; i++)
+        if (magnitude(a(i, k)) > magnitude(a(pivot, k)))
+            pivot = i;
+
+    if (a(pivot, k) == 0)
+        return false;
+
+    if (pivot != k) {
+        for (std::size_t j = 0; j < n; j++) {
+            typename M::type tmp = a(k, j);
+            a(k, j) = a(pivot, j);
+            a(pivot, j) = tmp;
+        }
+        unsigned tmp = perm[k];
+        perm[k] = perm[pivot];
+        perm[pivot] = tmp;
+        sign = -sign;
+    }
+    return true;
+}
+
+// Doolittle with partial pivoting: overwrites a with L (below the diagonal, unit diagonal
+// implied) and U (on and above it), such that P*A = L*U where row i of P*A is row perm[i]
+// of A. Returns the sign of P, or 0 if A is singular; a singular A is still fully factored,
+// with zeros on the diagonal of U, so that the determinant comes out as 0.
+template<typename M>
+constexpr int lu_factor(M a, std::size_t n, unsigned *perm) {
+    int sign = 1;
+    bool singular = false;
+    for (std::size_t i = 0; i < n; i++)
+        perm[i] = static_cast<unsigned>(i);
+
+    for (std::size_t k = 0; k < n; k++) {
+        if (!lu_pivot(a, n, k, perm, sign)) {
+            singular = true;
+            continue;// column is already eliminated below the diagonal
+        }
+
+        lu_eliminate_rows(a, n, k, k + 1, n);
+    }
+
+    return singular ? 0 : sign;
+}
+
+// Solves A*X = B for `nrhs` right-hand sides at once, given the output of lu_factor().
+// b is read through the permutation and x receives the solution; both are n x nrhs.
+// Substitution works on whole rows of x, so the inner loop is contiguous.
+template<typename L, typename B, typename X>
+constexpr void lu_solve(L lu, std::size_t n, const unsigned *perm, B b, X x, std::size_t nrhs) {
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < nrhs; j++)
+            x(i, j) = b(perm[i], j);
+
+    // L*Y = P*B
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t k = 0; k < i; k++) {
+            typename L::type l = lu(i, k);
+            for (std::size_t j = 0; j < nrhs; j++)
+                x(i, j) -= l * x(k, j);
+        }
+
+    // U*X = Y
+    for (std::size_t i = n; i-- > 0;) {
+        for (std::size_t k = i + 1; k < n; k++) {
+            typename L::type u = lu(i, k);
+            for (std::size_t j = 0; j < nrhs; j++)
+                x(i, j) -= u * x(k, j);
+        }
+        typename L::type d = lu(i, i);
+        for (std::size_t j = 0; j < nrhs; j++)
+            x(i, j) /= d;
+    }
+}
+
+// Fraction-free (Bareiss) elimination: every division is exact, so integer determinants
+// come out exact, unlike with LU. Destroys a.
+template<typename M>
+constexpr typename M::type det_bareiss(M a, std::size_t n) {
+    using T = typename M::type;
+
+    T prev = 1;
+    int sign = 1;
+    for (std::size_t k = 0; k + 1 < n; k++) {
+        if (a(k, k) == 0) {
+            std::size_t swap = k + 1;
+            while (swap < n && a(swap, k) == 0)
+                swap++;
+            if (swap == n)
+                return 0;
+
+            for (std::size_t j = k; j < n; j++) {
+                T tmp = a(k, j);
+                a(k, j) = a(swap, j);
+                a(swap, j) = tmp;
+            }
+            sign = -sign;
+        }
+
+        for (std::size_t i = k + 1; i < n; i++)
+            for (std::size_t j = k + 1; j < n; j++)
+                a(i, j) = (a(i, j) * a(k, k) - a(i, k) * a(k, j)) / prev;
+        prev = a(k, k);
+    }
+
+    return sign < 0 ? -a(n - 1, n - 1) : a(n - 1, n - 1);
+}
+
+}// namespace lingalg_detail
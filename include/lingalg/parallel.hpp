@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "lingalg.hpp"
+#include "lingalg/dynamic.hpp"
+#include "thread_pool.hpp"
+
+// Multithreaded versions of the large-matrix operations. Each one cuts its output into
+// tiles whose shape depends only on the problem size, never on the number of threads, and
+// every tile runs the same kernel in the same order as the single-threaded code. Results are
+// therefore bit-for-bit identical to the sequential ones on any number of cores.
+
+// Where an operation may run. Work below `threshold` (roughly in multiply-adds) is not worth
+// waking other threads for and stays on the calling thread.
+struct Parallel {
+    ThreadPool *pool = nullptr;// nullptr: ThreadPool::global()
+    std::size_t threshold = std::size_t{1} << 18;
+
+    [[nodiscard]] ThreadPool &get_pool() const {
+        return pool ? *pool : ThreadPool::global();
+    }
+
+    [[nodiscard]] bool worth_it(std::size_t work) const {
+        return work >= threshold && get_pool().size() > 1;
+    }
+};
+
+namespace lingalg_detail {
+
+// Rows of C per gemm task; a multiple of GEMM_MR so that tiles split exactly where
+// the sequential gemm switches between register blocks.
+constexpr std::size_t PAR_GEMM_ROWS = 8 * GEMM_MR;
+constexpr std::size_t PAR_TRANSPOSE_TILE = 64;
+constexpr std::size_t PAR_SOLVE_COLS = 64;
+
+template<typename T>
+void parallel_gemm(const Parallel &par, std::size_t m, std::size_t n, std::size_t k,
+                   const T *a, std::size_t lda, const T *b, std::size_t ldb, T *c, std::size_t ldc) {
+    if (!par.worth_it(m * n * k)) {
+        gemm<T>(m, n, k, a, lda, b, ldb, c, ldc);
+        return;
+    }
+
+    // columns are cut at GEMM_NC, where the sequential gemm starts a new panel anyway
+    std::size_t row_tiles = (m + PAR_GEMM_ROWS - 1) / PAR_GEMM_ROWS;
+    std::size_t col_tiles = (n + GEMM_NC - 1) / GEMM_NC;
+    par.get_pool().parallel_for(row_tiles * col_tiles, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; t++) {
+            std::size_t i = t / col_tiles * PAR_GEMM_ROWS;
+            std::size_t j = t % col_tiles * GEMM_NC;
+            gemm<T>(std::min(PAR_GEMM_ROWS, m - i), std::min(GEMM_NC, n - j), k,
+                    a + i * lda, lda, b + j, ldb, c + i * ldc + j, ldc);
+        }
+    });
+}
+
+// dst[c][r] = src[r][c], in square tiles so that both sides are touched a cache line at a time
+template<typename T>
+void parallel_transpose(const Parallel &par, std::size_t rows, std::size_t cols,
+                        const T *src, std::size_t lds, T *dst, std::size_t ldd) {
+    std::size_t row_tiles = (rows + PAR_TRANSPOSE_TILE - 1) / PAR_TRANSPOSE_TILE;
+    std::size_t col_tiles = (cols + PAR_TRANSPOSE_TILE - 1) / PAR_TRANSPOSE_TILE;
+
+    auto tiles = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; t++) {
+            std::size_t r0 = t / col_tiles * PAR_TRANSPOSE_TILE;
+            std::size_t c0 = t % col_tiles * PAR_TRANSPOSE_TILE;
+            std::size_t r1 = std::min(rows, r0 + PAR_TRANSPOSE_TILE);
+            std::size_t c1 = std::min(cols, c0 + PAR_TRANSPOSE_TILE);
+            for (std::size_t r = r0; r < r1; r++)
+                for (std::size_t c = c0; c < c1; c++)
+                    dst[c * ldd + r] = src[r * lds + c];
+        }
+    };
+
+    if (par.worth_it(rows * cols))
+        par.get_pool().parallel_for(row_tiles * col_tiles, 1, tiles);
+    else
+        tiles(0, row_tiles * col_tiles);
+}
+
+// lu_factor() with the trailing update of every step spread over the pool. Pivoting stays
+// sequential; it is O(n) per step against O(n^2) for the update.
+template<typename T>
+int parallel_lu_factor(const Parallel &par, StridedView<T> a, std::size_t n, unsigned *perm) {
+    if (!par.worth_it(n * n * n / 3))
+        return lu_factor(a, n, perm);
+
+    int sign = 1;
+    bool singular = false;
+    for (std::size_t i = 0; i < n; i++)
+        perm[i] = static_cast<unsigned>(i);
+
+    for (std::size_t k = 0; k < n; k++) {
+        if (!lu_pivot(a, n, k, perm, sign)) {
+            singular = true;
+            continue;
+        }
+
+        std::size_t rest = n - k - 1;
+        if (!par.worth_it(rest * rest)) {
+            lu_eliminate_rows(a, n, k, k + 1, n);
+            continue;
+        }
+
+        // enough rows per task to amortize the handoff, which costs about as much as a short row
+        std::size_t grain = std::max<std::size_t>(4, par.threshold / std::max<std::size_t>(rest, 1) / 4);
+        par.get_pool().parallel_for(rest, grain, [&](std::size_t begin, std::size_t end) {
+            lu_eliminate_rows(a, n, k, k + 1 + begin, k + 1 + end);
+        });
+    }
+
+    return singular ? 0 : sign;
+}
+
+// lu_solve() with the right-hand sides split into independent column blocks
+template<typename T>
+void parallel_lu_solve(const Parallel &par, StridedView<const T> lu, std::size_t n, const unsigned *perm,
+                       StridedView<const T> b, StridedView<T> x, std::size_t nrhs) {
+    if (!par.worth_it(n * n * nrhs) || nrhs <= PAR_SOLVE_COLS) {
+        lu_solve(lu, n, perm, b, x, nrhs);
+        return;
+    }
+
+    par.get_pool().parallel_for(nrhs, PAR_SOLVE_COLS, [&](std::size_t begin, std::size_t end) {
+        lu_solve(lu, n, perm, StridedView<const T>{b.p + begin, b.ld}, StridedView<T>{x.p + begin, x.ld}, end - begin);
+    });
+}
+
+// f(begin, end) over blocks of whole rows
+template<typename F>
+void parallel_rows(const Parallel &par, std::size_t rows, std::size_t cols, F &&f) {
+    if (!par.worth_it(rows * cols)) {
+        f(0, rows);
+        return;
+    }
+
+    std::size_t grain = std::max<std::size_t>(1, par.threshold / std::max<std::size_t>(cols, 1) / 4);
+    par.get_pool().parallel_for(rows, grain, f);
+}
+
+}// namespace lingalg_detail
+
+template<typename T>
+DynMatrix<T> multiply(const Parallel &par, const DynMatrix<T> &a, const DynMatrix<T> &b) {
+    if (a.cols() != b.rows())
+        throw std::invalid_argument{"dimension mismatch"};
+
+    DynMatrix<T> ret{a.rows(), b.cols()};
+    lingalg_detail::parallel_gemm<T>(par, a.rows(), b.cols(), a.cols(), a.data(), a.stride(), b.data(), b.stride(), ret.data(), ret.stride());
+    return ret;
+}
+
+// Fixed-size matrices this big usually live on the heap, so the result goes into `out`.
+template<typename T, unsigned R, unsigned K, unsigned O>
+void multiply(const Parallel &par, const Matrix<T, R, K> &a, const Matrix<T, K, O> &b, Matrix<T, R, O> &out) {
+    if (static_cast<const void *>(&out) == &a || static_cast<const void *>(&out) == &b)
+        throw std::invalid_argument{"multiply() output must not alias an operand"};
+
+    for (unsigned r = 0; r < R; r++)
+        for (unsigned c = 0; c < O; c++)
+            out[r][c] = 0;
+    lingalg_detail::parallel_gemm<T>(par, R, O, K, a.dat[0], K, b.dat[0], O, out.dat[0], O);
+}
+
+template<typename T>
+DynMatrix<T> transposed(const Parallel &par, const DynMatrix<T> &a) {
+    DynMatrix<T> ret{a.cols(), a.rows()};
+    lingalg_detail::parallel_transpose(par, a.rows(), a.cols(), a.data(), a.stride(), ret.data(), ret.stride());
+    return ret;
+}
+
+template<typename T, unsigned R, unsigned C>
+void transpose(const Parallel &par, const Matrix<T, R, C> &a, Matrix<T, C, R> &out) {
+    if (static_cast<const void *>(&out) == &a)
+        throw std::invalid_argument{"transpose() output must not alias its input"};
+
+    lingalg_detail::parallel_transpose(par, R, C, a.dat[0], C, out.dat[0], R);
+}
+
+template<typename T>
+T det(const Parallel &par, const DynMatrix<T> &a) {
+    if (a.rows() != a.cols())
+        throw std::invalid_argument{"can only det() square matrices"};
+    if constexpr (std::is_integral_v<T>) {
+        return a.det();// exact Bareiss; LU would round
+    } else {
+        DynMatrix<T> lu{a};
+        std::vector<unsigned> perm(a.rows());
+        T ret = lingalg_detail::parallel_lu_factor(par, lu.view(), a.rows(), perm.data());
+        for (std::size_t i = 0; i < a.rows(); i++)
+            ret *= lu[i][i];
+        return ret;
+    }
+}
+
+// solves a * x = b
+template<typename T>
+DynMatrix<T> solve(const Parallel &par, const DynMatrix<T> &a, const DynMatrix<T> &b) {
+    if (a.rows() != a.cols() || b.rows() != a.rows())
+        throw std::invalid_argument{"dimension mismatch"};
+
+    DynMatrix<T> lu{a};
+    std::vector<unsigned> perm(a.rows());
+    if (lingalg_detail::parallel_lu_factor(par, lu.view(), a.rows(), perm.data()) == 0)
+        throw std::runtime_error{"Singular matrix"};
+
+    DynMatrix<T> x{b.rows(), b.cols()};
+    lingalg_detail::parallel_lu_solve<T>(par, std::as_const(lu).view(), a.rows(), perm.data(), b.view(), x.view(), b.cols());
+    return x;
+}
+
+// element-wise f(a[r][c])
+template<typename T, typename F>
+DynMatrix<T> map(const Parallel &par, const DynMatrix<T> &a, F f) {
+    DynMatrix<T> ret{a.rows(), a.cols()};
+    lingalg_detail::parallel_rows(par, a.rows(), a.cols(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t r = begin; r < end; r++)
+            for (std::size_t c = 0; c < a.cols(); c++)
+                ret[r][c] = f(a[r][c]);
+    });
+    return ret;
+}
+
+// element-wise f(a[r][c], b[r][c])
+template<typename T, typename F>
+DynMatrix<T> zip(const Parallel &par, const DynMatrix<T> &a, const DynMatrix<T> &b, F f) {
+    if (a.rows() != b.rows() || a.cols() != b.cols())
+        throw std::invalid_argument{"dimension mismatch"};
+
+    DynMatrix<T> ret{a.rows(), a.cols()};
+    lingalg_detail::parallel_rows(par, a.rows(), a.cols(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t r = begin; r < end; r++)
+            for (std::size_t c = 0; c < a.cols(); c++)
+                ret[r][c] = f(a[r][c], b[r][c]);
+    });
+    return ret;
+}
+
+template<typename T>
+DynMatrix<T> add(const Parallel &par, const DynMatrix<T> &a, const DynMatrix<T> &b) {
+    return zip(par, a, b, [](T x, T y) { return x + y; });
+}
+
+template<typename T>
+DynMatrix<T> scale(const Parallel &par, const DynMatrix<T> &a, T s) {
+    return map(par, a, [s](T x) { return x * s; });
+}
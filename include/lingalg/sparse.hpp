@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "lingalg.hpp"
+#include "lingalg/dynamic.hpp"
+
+// A sparse matrix in compressed sparse row form: the nonzeros of row i are
+// values[row_begin[i] .. row_begin[i + 1]], in the columns given by col_index.
+template<typename T>
+class SparseMatrix {
+public:
+    typedef T type;
+
+    struct Entry {
+        std::size_t row;
+        std::size_t col;
+        T value;
+    };
+
+    std::vector<std::size_t> row_begin;// rows() + 1 entries
+    std::vector<unsigned> col_index;   // ascending within each row
+    std::vector<T> values;
+
+    SparseMatrix() : row_begin(1, 0) {}
+
+    // Entries may come in any order; duplicates are summed and zeros are dropped.
+    SparseMatrix(std::size_t rows, std::size_t cols, std::vector<Entry> entries) : c(cols) {
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.row != b.row ? a.row < b.row : a.col < b.col;
+        });
+
+        row_begin.assign(rows + 1, 0);
+        for (std::size_t i = 0; i < entries.size();) {
+            const Entry &e = entries[i];
+            if (e.row >= rows || e.col >= cols)
+                throw std::out_of_range{"SparseMatrix entry out of range"};
+
+            T sum = 0;
+            for (; i < entries.size() && entries[i].row == e.row && entries[i].col == e.col; i++)
+                sum += entries[i].value;
+
+            if (sum != 0) {
+                col_index.push_back(static_cast<unsigned>(e.col));
+                values.push_back(sum);
+                row_begin[e.row + 1]++;
+            }
+        }
+
+        for (std::size_t i = 0; i < rows; i++)
+            row_begin[i + 1] += row_begin[i];
+    }
+
+    explicit SparseMatrix(const DynMatrix<T> &dense) : c(dense.cols()) {
+        row_begin.reserve(dense.rows() + 1);
+        row_begin.push_back(0);
+        for (std::size_t i = 0; i < dense.rows(); i++) {
+            for (std::size_t j = 0; j < dense.cols(); j++)
+                if (dense[i][j] != 0) {
+                    col_index.push_back(static_cast<unsigned>(j));
+                    values.push_back(dense[i][j]);
+                }
+            row_begin.push_back(values.size());
+        }
+    }
+
+    [[nodiscard]] std::size_t rows() const { return row_begin.size() - 1; }
+    [[nodiscard]] std::size_t cols() const { return c; }
+    [[nodiscard]] std::size_t nonzeros() const { return values.size(); }
+
+    T operator()(std::size_t row, std::size_t col) const {
+        auto begin = col_index.begin() + row_begin[row];
+        auto end = col_index.begin() + row_begin[row + 1];
+        auto it = std::lower_bound(begin, end, col);
+        return it != end && *it == col ? values[it - col_index.begin()] : T{0};
+    }
+
+    // y = A * x, with x of size cols() and y of size rows()
+    void multiply(const T *x, T *y) const {
+        for (std::size_t i = 0; i + 1 < row_begin.size(); i++) {
+            T sum = 0;
+            for (std::size_t k = row_begin[i]; k < row_begin[i + 1]; k++)
+                sum += values[k] * x[col_index[k]];
+            y[i] = sum;
+        }
+    }
+
+    std::vector<T> operator*(const std::vector<T> &x) const {
+        if (x.size() != cols())
+            throw std::invalid_argument{"dimension mismatch"};
+
+        std::vector<T> y(rows());
+        multiply(x.data(), y.data());
+        return y;
+    }
+
+    template<unsigned S>
+    Vector<T, S> operator*(const Vector<T, S> &x) const {
+        if (rows() != S || cols() != S)
+            throw std::invalid_argument{"dimension mismatch"};
+
+        Vector<T, S> y;
+        multiply(x.dat[0], y.dat[0]);
+        return y;
+    }
+
+    DynMatrix<T> to_dense() const {
+        DynMatrix<T> ret{rows(), cols()};
+        for (std::size_t i = 0; i < rows(); i++)
+            for (std::size_t k = row_begin[i]; k < row_begin[i + 1]; k++)
+                ret[i][col_index[k]] = values[k];
+        return ret;
+    }
+
+private:
+    std::size_t c = 0;
+};
+
+template<typename T>
+struct SolveResult {
+    std::size_t iterations;
+    T residual;// ||b - A x|| / ||b||
+    bool converged;
+};
+
+// Jacobi-preconditioned conjugate gradient for symmetric positive definite A. x holds the
+// initial guess and receives the solution. Stops once the relative residual drops below
+// `tolerance` or after `max_iterations` (default: ten times the size of the system; in
+// exact arithmetic n steps would do, but rounding makes ill-conditioned systems take more).
+template<typename T>
+SolveResult<T> conjugate_gradient(const SparseMatrix<T> &a, const T *b, T *x,
+                                  T tolerance = std::sqrt(std::numeric_limits<T>::epsilon()),
+                                  std::size_t max_iterations = 0) {
+    static_assert(std::is_floating_point_v<T>, "conjugate gradient needs floating point");
+    using lingalg_detail::dot;
+
+    std::size_t n = a.rows();
+    if (a.cols() != n)
+        throw std::invalid_argument{"conjugate gradient needs a square matrix"};
+    if (max_iterations == 0)
+        max_iterations = 10 * n;
+
+    std::vector<T> inv_diag(n), r(n), z(n), p(n), ap(n);
+    for (std::size_t i = 0; i < n; i++) {
+        T d = a(i, i);
+        inv_diag[i] = d != 0 ? T{1} / d : T{1};
+    }
+
+    T b_norm = std::sqrt(dot(b, b, n));
+    if (b_norm == 0)
+        b_norm = 1;
+
+    a.multiply(x, r.data());
+    for (std::size_t i = 0; i < n; i++) {
+        r[i] = b[i] - r[i];
+        z[i] = inv_diag[i] * r[i];
+        p[i] = z[i];
+    }
+
+    T rz = dot(r.data(), z.data(), n);
+    T residual = std::sqrt(dot(r.data(), r.data(), n)) / b_norm;
+
+    std::size_t it = 0;
+    for (; it < max_iterations && residual > tolerance; it++) {
+        a.multiply(p.data(), ap.data());
+        T pap = dot(p.data(), ap.data(), n);
+        if (pap <= 0)
+            break;// A is not positive definite along p
+
+        T alpha = rz / pap;
+        for (std::size_t i = 0; i < n; i++) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * ap[i];
+            z[i] = inv_diag[i] * r[i];
+        }
+
+        T rz_next = dot(r.data(), z.data(), n);
+        T beta = rz_next / rz;
+        rz = rz_next;
+        for (std::size_t i = 0; i < n; i++)
+            p[i] = z[i] + beta * p[i];
+
+        residual = std::sqrt(dot(r.data(), r.data(), n)) / b_norm;
+    }
+
+    return SolveResult<T>{it, residual, residual <= tolerance};
+}
+
+template<typename T>
+SolveResult<T> conjugate_gradient(const SparseMatrix<T> &a, const std::vector<T> &b, std::vector<T> &x,
+                                  T tolerance = std::sqrt(std::numeric_limits<T>::epsilon()),
+                                  std::size_t max_iterations = 0) {
+    if (b.size() != a.rows())
+        throw std::invalid_argument{"dimension mismatch"};
+    x.resize(a.cols());
+    return conjugate_gradient(a, b.data(), x.data(), tolerance, max_iterations);
+}
+
+template<typename T, unsigned S>
+SolveResult<T> conjugate_gradient(const SparseMatrix<T> &a, const Vector<T, S> &b, Vector<T, S> &x,
+                                  T tolerance = std::sqrt(std::numeric_limits<T>::epsilon()),
+                                  std::size_t max_iterations = 0) {
+    if (a.rows() != S)
+        throw std::invalid_argument{"dimension mismatch"};
+    return conjugate_gradient(a, b.dat[0], x.dat[0], tolerance, max_iterations);
+}
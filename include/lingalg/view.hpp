@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+// Whether the current evaluation happens at compile time, so that kernels can step around
+// intrinsics and other things constant evaluation can't do (std::is_constant_evaluated() is
+// C++20; this builtin is what it is implemented with).
+#if defined(__GNUC__) || defined(__clang__)
+#define LINGALG_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define LINGALG_CONSTANT_EVALUATED() false
+#endif
+
+// The LU and elimination kernels address their matrix through a view, `m(r, c)`, rather
+// than a raw pointer, so the same code runs on DynMatrix rows and on the T[R][C] inside a
+// Matrix, including during constant evaluation.
+namespace lingalg_detail {
+
+// row-major storage with an arbitrary row stride
+template<typename T>
+struct StridedView {
+    using type = std::remove_const_t<T>;
+
+    T *p;
+    std::size_t ld;
+
+    constexpr T &operator()(std::size_t r, std::size_t c) const { return p[r * ld + c]; }
+};
+
+// A T[R][C] array. Going through the rows keeps every access inside its own row, which
+// constant evaluation insists on: a T* into the first row may not be walked into the next.
+template<typename T, unsigned C>
+struct RowsView {
+    using type = std::remove_const_t<T>;
+
+    T (*rows)[C];
+
+    constexpr T &operator()(std::size_t r, std::size_t c) const { return rows[r][c]; }
+};
+
+}// namespace lingalg_detail
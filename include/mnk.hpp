@@ -0,0 +1,663 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MNK_AVX2 1
+#endif
+
+// m,n,k-games: two players take turns on an m by n board, and the first to get k in a row,
+// horizontally, vertically or diagonally, wins. TicTacToe is the 3,3,3 game, gomoku 15,15,5.
+//
+// Boards are bitboards with one bit per square, row by row, and an empty guard column after
+// each row, so shifting by 1 (along a row), STRIDE (a column), STRIDE + 1 and STRIDE - 1 (the
+// diagonals) never carries a square into the next row. k in a row is then found for all
+// squares at once by shifting and masking, in log k steps per direction.
+//
+// Squares are numbered row * n + column outside; bits row * STRIDE + column inside.
+
+typedef int32_t MnkScore;
+
+// A win scores MNK_WIN less the plies to it, so faster wins score higher
+constexpr MnkScore MNK_WIN = 1 << 30;
+constexpr uint32_t MNK_MAX_PLY = 256;// table entries keep depths in a byte
+constexpr MnkScore MNK_INF = MNK_WIN + 1;
+
+constexpr inline bool mnk_is_win(MnkScore score) {
+    return score >= MNK_WIN - static_cast<MnkScore>(MNK_MAX_PLY) || score <= -MNK_WIN + static_cast<MnkScore>(MNK_MAX_PLY);
+}
+
+enum class MnkState : uint_fast8_t {
+    ONGOING,
+    DRAW,
+    X_WIN,
+    O_WIN
+};
+
+// A bitset of WORDS 64-bit words. With AVX2, the 256-bit one shifts in registers.
+template <uint32_t WORDS>
+struct MnkBitboard {
+    uint64_t w[WORDS];
+
+    constexpr bool test(uint32_t bit) const { return w[bit / 64] >> bit % 64 & 1; }
+    constexpr void set(uint32_t bit) { w[bit / 64] |= uint64_t{1} << bit % 64; }
+    constexpr void flip(uint32_t bit) { w[bit / 64] ^= uint64_t{1} << bit % 64; }
+
+    constexpr bool any() const {
+        uint64_t ret = 0;
+        for (uint32_t i = 0; i < WORDS; i++)
+            ret |= w[i];
+        return ret != 0;
+    }
+
+    uint32_t count() const {
+        uint32_t ret = 0;
+        for (uint32_t i = 0; i < WORDS; i++)
+            ret += static_cast<uint32_t>(__builtin_popcountll(w[i]));
+        return ret;
+    }
+
+    // calls f(bit) for every set bit, in ascending order
+    template <class F>
+    void each(F &&f) const {
+        for (uint32_t i = 0; i < WORDS; i++)
+            for (uint64_t bits = w[i]; bits; bits &= bits - 1)
+                f(static_cast<uint32_t>(i * 64 + __builtin_ctzll(bits)));
+    }
+
+    constexpr MnkBitboard operator&(const MnkBitboard &rhs) const {
+        MnkBitboard ret{};
+        for (uint32_t i = 0; i < WORDS; i++)
+            ret.w[i] = w[i] & rhs.w[i];
+        return ret;
+    }
+
+    constexpr MnkBitboard operator|(const MnkBitboard &rhs) const {
+        MnkBitboard ret{};
+        for (uint32_t i = 0; i < WORDS; i++)
+            ret.w[i] = w[i] | rhs.w[i];
+        return ret;
+    }
+
+    constexpr MnkBitboard operator^(const MnkBitboard &rhs) const {
+        MnkBitboard ret{};
+        for (uint32_t i = 0; i < WORDS; i++)
+            ret.w[i] = w[i] ^ rhs.w[i];
+        return ret;
+    }
+
+    constexpr MnkBitboard operator~() const {
+        MnkBitboard ret{};
+        for (uint32_t i = 0; i < WORDS; i++)
+            ret.w[i] = ~w[i];
+        return ret;
+    }
+
+    constexpr bool operator==(const MnkBitboard &rhs) const {
+        for (uint32_t i = 0; i < WORDS; i++)
+            if (w[i] != rhs.w[i])
+                return false;
+        return true;
+    }
+
+    constexpr bool operator!=(const MnkBitboard &rhs) const { return !(*this == rhs); }
+
+    // bit i of the result is bit i + S of this
+    template <uint32_t S>
+    MnkBitboard shr() const {
+#ifdef MNK_AVX2
+        if constexpr (WORDS == 4) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w));
+            __m256i lo = lanes_down<S / 64>(v);
+            if constexpr (S % 64 != 0)
+                lo = _mm256_or_si256(_mm256_srli_epi64(lo, S % 64), _mm256_slli_epi64(lanes_down<S / 64 + 1>(v), 64 - S % 64));
+            MnkBitboard ret;
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(ret.w), lo);
+            return ret;
+        }
+#endif
+        constexpr uint32_t q = S / 64, r = S % 64;
+        MnkBitboard ret{};
+        for (uint32_t i = 0; i + q < WORDS; i++) {
+            ret.w[i] = w[i + q] >> r;
+            if constexpr (r != 0)
+                if (i + q + 1 < WORDS)
+                    ret.w[i] |= w[i + q + 1] << (64 - r);
+        }
+        return ret;
+    }
+
+    // bit i + S of the result is bit i of this
+    template <uint32_t S>
+    MnkBitboard shl() const {
+#ifdef MNK_AVX2
+        if constexpr (WORDS == 4) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w));
+            __m256i hi = lanes_up<S / 64>(v);
+            if constexpr (S % 64 != 0)
+                hi = _mm256_or_si256(_mm256_slli_epi64(hi, S % 64), _mm256_srli_epi64(lanes_up<S / 64 + 1>(v), 64 - S % 64));
+            MnkBitboard ret;
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(ret.w), hi);
+            return ret;
+        }
+#endif
+        constexpr uint32_t q = S / 64, r = S % 64;
+        MnkBitboard ret{};
+        for (uint32_t i = q; i < WORDS; i++) {
+            ret.w[i] = w[i - q] << r;
+            if constexpr (r != 0)
+                if (i > q)
+                    ret.w[i] |= w[i - q - 1] >> (64 - r);
+        }
+        return ret;
+    }
+
+private:
+#ifdef MNK_AVX2
+    // lane i of the result is lane i + Q of v, or 0
+    template <uint32_t Q>
+    static __m256i lanes_down(__m256i v) {
+        if constexpr (Q >= 4) {
+            return _mm256_setzero_si256();
+        } else {
+            constexpr int imm = static_cast<int>(std::min(Q, 3u) | std::min(Q + 1, 3u) << 2 | std::min(Q + 2, 3u) << 4 | 3u << 6);
+            __m256i keep = _mm256_set_epi64x(Q == 0 ? -1 : 0, Q <= 1 ? -1 : 0, Q <= 2 ? -1 : 0, -1);
+            return _mm256_and_si256(_mm256_permute4x64_epi64(v, imm), keep);
+        }
+    }
+
+    // lane i + Q of the result is lane i of v, or 0
+    template <uint32_t Q>
+    static __m256i lanes_up(__m256i v) {
+        if constexpr (Q >= 4) {
+            return _mm256_setzero_si256();
+        } else {
+            constexpr int imm = static_cast<int>(0u | (1 >= Q ? 1 - Q : 0u) << 2 | (2 >= Q ? 2 - Q : 0u) << 4 | (3 - Q) << 6);
+            __m256i keep = _mm256_set_epi64x(-1, Q <= 2 ? -1 : 0, Q <= 1 ? -1 : 0, Q == 0 ? -1 : 0);
+            return _mm256_and_si256(_mm256_permute4x64_epi64(v, imm), keep);
+        }
+    }
+#endif
+};
+
+namespace mnk_detail {
+
+// 1 or 2 words, or a multiple of 4 so that AVX2 can take them
+constexpr uint32_t words_for(uint32_t bits) {
+    uint32_t words = (bits + 63) / 64;
+    return words <= 2 ? words : (words + 3) / 4 * 4;
+}
+
+constexpr uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = state += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ z >> 27) * 0x94d049bb133111ebULL;
+    return z ^ z >> 31;
+}
+
+// hash keys for a stone of either side on every bit, and for the side to move
+template <uint32_t BITS>
+struct Zobrist {
+    uint64_t stone[2][BITS]{};
+    uint64_t x_turn = 0;
+
+    constexpr Zobrist() {
+        uint64_t state = BITS;
+        for (auto &side: stone)
+            for (uint64_t &key: side)
+                key = splitmix64(state);
+        x_turn = splitmix64(state);
+    }
+};
+
+template <class Board>
+constexpr Board board_mask(uint32_t rows, uint32_t cols) {
+    Board ret{};
+    for (uint32_t r = 0; r < rows; r++)
+        for (uint32_t c = 0; c < cols; c++)
+            ret.set(r * (cols + 1) + c);
+    return ret;
+}
+
+}// namespace mnk_detail
+
+template <uint32_t M, uint32_t N, uint32_t K>
+class MnkGame {
+public:
+    static_assert(M > 0 && N > 0 && K > 0 && K <= std::max(M, N), "no line of K fits on the board");
+    static_assert(K < 16, "window counts are 4 bits wide");
+
+    constexpr static uint32_t ROWS = M, COLS = N, STRIDE = N + 1;
+    constexpr static uint32_t SQUARES = M * N;
+    constexpr static uint32_t BITS = M * STRIDE;
+
+    typedef MnkBitboard<mnk_detail::words_for(BITS)> Board;
+
+    Board x{}, o{};
+    bool is_x_turn = true;
+    uint32_t num_moves = 0;
+    MnkState state = MnkState::ONGOING;
+    uint64_t hash = ZOBRIST.x_turn;
+
+    constexpr static uint32_t to_bit(uint32_t square) { return square / N * STRIDE + square % N; }
+    constexpr static uint32_t to_square(uint32_t bit) { return bit / STRIDE * N + bit % STRIDE; }
+
+    Board empty() const { return ~(x | o) & BOARD; }
+
+    bool is_legal(uint32_t square) const {
+        return square < SQUARES && !(x | o).test(to_bit(square));
+    }
+
+    void print(std::ostream &out = std::cout) const {
+        for (uint32_t r = ROWS; r-- > 0;) {
+            for (uint32_t c = 0; c < COLS; c++) {
+                uint32_t bit = r * STRIDE + c;
+                out << (x.test(bit) ? "X " : o.test(bit) ? "O " : ". ");
+            }
+            out << '\n';
+        }
+        out << (is_x_turn ? 'X' : 'O') << " is to move\n";
+    }
+
+    // moves and takes back by bit, not square
+    void make_move(uint32_t bit) {
+        Board &own = is_x_turn ? x : o;
+        own.set(bit);
+        hash ^= ZOBRIST.stone[is_x_turn][bit] ^ ZOBRIST.x_turn;
+        if (has_line(own))
+            state = is_x_turn ? MnkState::X_WIN : MnkState::O_WIN;
+        else if (num_moves + 1 == SQUARES)
+            state = MnkState::DRAW;
+        num_moves++;
+        is_x_turn ^= true;
+    }
+
+    void unmake_move(uint32_t bit) {
+        is_x_turn ^= true;
+        (is_x_turn ? x : o).flip(bit);
+        hash ^= ZOBRIST.stone[is_x_turn][bit] ^ ZOBRIST.x_turn;
+        num_moves--;
+        state = MnkState::ONGOING;
+    }
+
+    void play(uint32_t square) {
+        if (state != MnkState::ONGOING || !is_legal(square))
+            throw std::runtime_error{"Illegal move"};
+        make_move(to_bit(square));
+    }
+
+    static bool has_line(const Board &b) {
+        return (runs<1, 1>(b) | runs<STRIDE, 1>(b) | runs<STRIDE + 1, 1>(b) | runs<STRIDE - 1, 1>(b)).any();
+    }
+
+    // The empty squares within `reach` king steps of a stone, or all of them for reach 0 or
+    // if there are none
+    Board candidates(uint32_t reach) const {
+        Board stones = x | o;
+        if (reach == 0)
+            return empty();
+        Board near = stones;
+        for (uint32_t i = 0; i < reach; i++)
+            near = near | near.template shr<1>() | near.template shl<1>() |
+                   near.template shr<STRIDE>() | near.template shl<STRIDE>() |
+                   near.template shr<STRIDE + 1>() | near.template shl<STRIDE + 1>() |
+                   near.template shr<STRIDE - 1>() | near.template shl<STRIDE - 1>();
+        near = near & empty();
+        return near.any() ? near : empty();
+    }
+
+    // Heuristic score for the side to move: every window of K squares that the opponent has
+    // no stone in counts for the side with c stones in it, 4^(c - 1), and the same against.
+    MnkScore evaluate() const {
+        const Board &own = is_x_turn ? x : o, &other = is_x_turn ? o : x;
+        return potential(own, other) - potential(other, own);
+    }
+
+private:
+    // every square of the board, without the guard columns
+    constexpr static Board BOARD = mnk_detail::board_mask<Board>(M, N);
+    constexpr static mnk_detail::Zobrist<BITS> ZOBRIST{};
+
+    // bits i where b has LEN * 2^j squares in a row from i along D, carried on to K
+    template <uint32_t D, uint32_t LEN>
+    static Board runs(const Board &b) {
+        if constexpr (2 * LEN <= K)
+            return runs<D, 2 * LEN>(b & b.template shr<D * LEN>());
+        else if constexpr (LEN < K)
+            return b & b.template shr<D * (K - LEN)>();
+        else
+            return b;
+    }
+
+    static MnkScore potential(const Board &own, const Board &other) {
+        Board open = ~other & BOARD;
+        return potential<1>(own, open) + potential<STRIDE>(own, open) + potential<STRIDE + 1>(own, open) + potential<STRIDE - 1>(own, open);
+    }
+
+    template <uint32_t D>
+    static MnkScore potential(const Board &own, const Board &open) {
+        Board windows = runs<D, 1>(open);
+        if (!windows.any())
+            return 0;
+
+        // the own stones in the window from every bit, bit-sliced
+        Board count[4]{};
+        add_shifted<D>(own, count, std::make_index_sequence<K>{});
+
+        MnkScore ret = 0;
+        for (uint32_t c = 1; c < K; c++) {
+            Board match = windows;
+            for (uint32_t b = 0; b < 4; b++)
+                match = match & (c >> b & 1 ? count[b] : ~count[b]);
+            ret += static_cast<MnkScore>(match.count()) << 2 * std::min(c - 1, 8u);
+        }
+        return ret;
+    }
+
+    template <uint32_t D, std::size_t... I>
+    static void add_shifted(const Board &own, Board (&count)[4], std::index_sequence<I...>) {
+        (add(count, own.template shr<D * static_cast<uint32_t>(I)>()), ...);
+    }
+
+    static void add(Board (&count)[4], Board carry) {
+        for (uint32_t b = 0; b < 4 && carry.any(); b++) {
+            Board next = count[b] & carry;
+            count[b] = count[b] ^ carry;
+            carry = next;
+        }
+    }
+};
+
+struct MnkLimits {
+    uint32_t max_depth = MNK_MAX_PLY;// plies
+    double seconds = 0;              // time budget, none if 0
+    uint32_t reach = 0;              // see MnkGame::candidates()
+    ThreadPool *pool = nullptr;      // nullptr: the calling thread only
+};
+
+struct MnkResult {
+    int32_t square = -1;// -1 if the game is over
+    MnkScore score = 0; // for the side to move
+    uint32_t depth = 0; // of the last completed iteration
+    uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+// Transposition table shared by all threads of a search, without locks: an entry is two
+// atomic words, the data and the key xor the data, so an entry torn by two threads storing
+// at once fails the key check instead of handing out a mix of both.
+class MnkTransTable {
+public:
+    enum Bound : uint8_t {
+        NONE,
+        EXACT,
+        LOWER,
+        UPPER
+    };
+
+    struct Entry {
+        MnkScore score;// relative to the position, see MnkSearch
+        uint16_t move; // bit, or NO_MOVE
+        uint8_t depth;
+        Bound bound;
+    };
+
+    constexpr static uint16_t NO_MOVE = std::numeric_limits<uint16_t>::max();
+
+    explicit MnkTransTable(std::size_t bytes = std::size_t{16} << 20) {
+        size = 1;
+        while (size * 2 * sizeof(Slot) <= bytes)
+            size *= 2;
+        slots.reset(new Slot[size]);
+        clear();
+    }
+
+    bool probe(uint64_t key, Entry &out) const {
+        const Slot &slot = slots[key & (size - 1)];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.check.load(std::memory_order_relaxed) ^ data) != key)
+            return false;
+        out = unpack(data);
+        return out.bound != NONE;
+    }
+
+    // keeps the deeper of two results for one position, and the newer for two
+    void store(uint64_t key, MnkScore score, uint16_t move, uint32_t depth, Bound bound) {
+        Slot &slot = slots[key & (size - 1)];
+        Entry old;
+        if (probe(key, old) && old.depth > depth)
+            return;
+        uint64_t data = pack({score, move, static_cast<uint8_t>(depth), bound});
+        slot.data.store(data, std::memory_order_relaxed);
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+    void clear() {
+        for (std::size_t i = 0; i < size; i++) {
+            slots[i].data.store(0, std::memory_order_relaxed);
+            slots[i].check.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check, data;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t size;
+
+    static uint64_t pack(const Entry &e) {
+        return static_cast<uint32_t>(e.score) | uint64_t{e.move} << 32 | uint64_t{e.depth} << 48 | uint64_t{e.bound} << 56;
+    }
+
+    static Entry unpack(uint64_t data) {
+        return {static_cast<MnkScore>(static_cast<uint32_t>(data)), static_cast<uint16_t>(data >> 32), static_cast<uint8_t>(data >> 48), static_cast<Bound>(data >> 56)};
+    }
+};
+
+// Iterative deepening alpha-beta negamax. Moves are tried best first: the table's move, then
+// by how often they caused a cutoff before (history heuristic). Each iteration is started
+// only if the previous one took less than half the time left; one that runs out of time is
+// dropped.
+//
+// At the root, the previous iteration's best move is searched first, with a full window.
+// The others only need to show they are not better, with a null window around its score,
+// so they are searched in parallel on the pool, each on its own copy of the game; those
+// that turn out better are searched again for their exact score. The table is shared, but
+// its results only cut the search off at exactly the depth they were searched to, which
+// leaves every score a function of the position and depth alone. The best move is therefore
+// the same on any number of threads; only a time budget makes it depend on timing.
+template <uint32_t M, uint32_t N, uint32_t K>
+class MnkSearch {
+public:
+    typedef MnkGame<M, N, K> Game;
+
+    explicit MnkSearch(std::size_t table_bytes = std::size_t{16} << 20) : table(table_bytes) {}
+
+    MnkResult search(const Game &game, const MnkLimits &limits = {}) {
+        auto start = std::chrono::steady_clock::now();
+        deadline = limits.seconds > 0 ? start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(limits.seconds)) : std::chrono::steady_clock::time_point::max();
+        reach = limits.reach;
+        stopped.store(false, std::memory_order_relaxed);
+
+        MnkResult ret;
+        if (game.state != MnkState::ONGOING)
+            return ret;
+
+        std::vector<uint16_t> moves;
+        game.candidates(reach).each([&](uint32_t bit) { moves.push_back(static_cast<uint16_t>(bit)); });
+        // one worker per root move, so that its history does not depend on the scheduling
+        std::vector<Worker> workers(moves.size());
+        std::vector<MnkScore> scores(moves.size());
+
+        uint32_t max_depth = std::min({limits.max_depth, Game::SQUARES - game.num_moves, MNK_MAX_PLY - 1});
+        for (uint32_t depth = 1; depth <= max_depth; depth++) {
+            auto iteration_start = std::chrono::steady_clock::now();
+            MnkScore first = search_move(workers[0], game, moves[0], depth, -MNK_INF, MNK_INF);
+
+            auto others = [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; i++) {
+                    scores[i] = search_move(workers[i], game, moves[i], depth, first, first + 1);
+                    if (scores[i] > first)
+                        scores[i] = search_move(workers[i], game, moves[i], depth, first, MNK_INF);
+                }
+            };
+            if (limits.pool)
+                limits.pool->parallel_for(moves.size() - 1, 1, [&](std::size_t begin, std::size_t end) { others(begin + 1, end + 1); });
+            else
+                others(1, moves.size());
+            if (stopped.load(std::memory_order_relaxed))
+                break;
+
+            // ties go to the move searched first, then to the lowest square
+            std::size_t best = 0;
+            MnkScore score = first;
+            for (std::size_t i = 1; i < moves.size(); i++)
+                if (scores[i] > score || (scores[i] == score && best != 0 && moves[i] < moves[best])) {
+                    best = i;
+                    score = scores[i];
+                }
+
+            ret.square = static_cast<int32_t>(Game::to_square(moves[best]));
+            ret.score = score;
+            ret.depth = depth;
+            // a win or loss within the horizon is the fastest there is; one from the table may not be
+            if (mnk_is_win(score) && MNK_WIN - std::abs(score) <= static_cast<MnkScore>(depth))
+                break;
+
+            // the best move first next time
+            std::rotate(moves.begin(), moves.begin() + static_cast<std::ptrdiff_t>(best), moves.begin() + static_cast<std::ptrdiff_t>(best) + 1);
+            std::rotate(workers.begin(), workers.begin() + static_cast<std::ptrdiff_t>(best), workers.begin() + static_cast<std::ptrdiff_t>(best) + 1);
+
+            auto now = std::chrono::steady_clock::now();
+            if (deadline != std::chrono::steady_clock::time_point::max() && (now - iteration_start) * 2 > deadline - now)
+                break;
+        }
+
+        for (const Worker &worker: workers)
+            ret.nodes += worker.nodes;
+        ret.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return ret;
+    }
+
+    void clear() { table.clear(); }
+
+private:
+    // what one thread needs for a search of its own
+    struct Worker {
+        Game game;
+        uint32_t history[Game::BITS]{};
+        uint64_t nodes = 0;
+    };
+
+    MnkTransTable table;
+    std::chrono::steady_clock::time_point deadline;
+    uint32_t reach = 0;
+    std::atomic<bool> stopped{false};
+
+    // wins are stored as plies from the position, not from the root
+    static MnkScore to_table(MnkScore score, uint32_t ply) {
+        return score >= MNK_WIN - static_cast<MnkScore>(MNK_MAX_PLY) ? score + static_cast<MnkScore>(ply) : score <= -MNK_WIN + static_cast<MnkScore>(MNK_MAX_PLY) ? score - static_cast<MnkScore>(ply) : score;
+    }
+
+    static MnkScore from_table(MnkScore score, uint32_t ply) {
+        return score >= MNK_WIN - static_cast<MnkScore>(MNK_MAX_PLY) ? score - static_cast<MnkScore>(ply) : score <= -MNK_WIN + static_cast<MnkScore>(MNK_MAX_PLY) ? score + static_cast<MnkScore>(ply) : score;
+    }
+
+    MnkScore search_move(Worker &worker, const Game &root, uint16_t move, uint32_t depth, MnkScore alpha, MnkScore beta) {
+        worker.game = root;
+        worker.game.make_move(move);
+        return -negamax(worker, depth - 1, 1, -beta, -alpha);
+    }
+
+    MnkScore negamax(Worker &worker, uint32_t depth, uint32_t ply, MnkScore alpha, MnkScore beta) {
+        if ((++worker.nodes & 1023) == 0 && std::chrono::steady_clock::now() >= deadline)
+            stopped.store(true, std::memory_order_relaxed);
+        if (stopped.load(std::memory_order_relaxed))
+            return 0;
+
+        Game &game = worker.game;
+        switch (game.state) {
+            case MnkState::ONGOING:
+                break;
+            case MnkState::DRAW:
+                return 0;
+            default:// the side that just moved made a line
+                return -(MNK_WIN - static_cast<MnkScore>(ply));
+        }
+        if (depth == 0)
+            return game.evaluate();
+
+        MnkScore alpha_in = alpha;
+        uint16_t table_move = MnkTransTable::NO_MOVE;
+        MnkTransTable::Entry e;
+        if (table.probe(game.hash, e)) {
+            table_move = e.move;
+            MnkScore stored = from_table(e.score, ply);
+            if (e.depth == depth) {
+                if (e.bound == MnkTransTable::EXACT)
+                    return stored;
+                if (e.bound == MnkTransTable::LOWER)
+                    alpha = std::max(alpha, stored);
+                else
+                    beta = std::min(beta, stored);
+                if (alpha >= beta)
+                    return stored;
+            }
+        }
+
+        uint16_t moves[Game::SQUARES];
+        uint32_t count = 0;
+        game.candidates(reach).each([&](uint32_t bit) { moves[count++] = static_cast<uint16_t>(bit); });
+        // insertion sort, the table's move first, then by history; ties stay in board order
+        for (uint32_t i = 1; i < count; i++) {
+            uint16_t mov = moves[i];
+            uint32_t j = i;
+            for (; j > 0 && (mov == table_move || (moves[j - 1] != table_move && worker.history[mov] > worker.history[moves[j - 1]])); j--)
+                moves[j] = moves[j - 1];
+            moves[j] = mov;
+        }
+
+        MnkScore value = -MNK_INF;
+        uint16_t best = MnkTransTable::NO_MOVE;
+        for (uint32_t i = 0; i < count; i++) {
+            game.make_move(moves[i]);
+            MnkScore score = -negamax(worker, depth - 1, ply + 1, -beta, -alpha);
+            game.unmake_move(moves[i]);
+            if (stopped.load(std::memory_order_relaxed))
+                return 0;
+
+            if (score > value) {
+                value = score;
+                best = moves[i];
+            }
+            if (value >= beta) {
+                worker.history[moves[i]] += depth * depth;
+                break;
+            }
+            alpha = std::max(alpha, value);
+        }
+
+        MnkTransTable::Bound bound = value <= alpha_in ? MnkTransTable::UPPER : value >= beta ? MnkTransTable::LOWER : MnkTransTable::EXACT;
+        table.store(game.hash, to_table(value, ply), best, depth, bound);
+        return value;
+    }
+};
+
+// TicTacToe as an m,n,k-game
+typedef MnkGame<3, 3, 3> MnkTicTacToe;
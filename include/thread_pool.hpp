@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A fixed set of threads, each with its own deque of tasks. A thread works through its own
+// deque from the back and, once that is empty, steals from the front of the others, so a
+// thread that finishes its share early takes over work that would otherwise queue up
+// behind a slow one.
+//
+// The only way in is parallel_for(), which blocks until its range is done. While it waits,
+// the calling thread runs tasks too, so nested parallel_for() calls from inside a task
+// cannot deadlock and a pool of size 1 simply runs everything inline.
+class ThreadPool {
+public:
+    // `threads` counts the caller of parallel_for() as one, so n threads start n - 1 workers
+    explicit ThreadPool(unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+        threads = std::max(1u, threads);
+        for (unsigned i = 0; i < threads; i++)
+            queues.push_back(std::make_unique<Queue>());
+
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back([this, i] { work(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard{sleep_lock};
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker: workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] unsigned size() const { return static_cast<unsigned>(queues.size()); }
+
+    static ThreadPool &global() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // Calls f(begin, end) over consecutive chunks of [0, n) of at most `grain` each. The chunks
+    // do not depend on the number of threads. The first exception thrown by f is rethrown
+    // here, once every chunk has finished.
+    template<typename F>
+    void parallel_for(std::size_t n, std::size_t grain, F &&f) {
+        grain = std::max<std::size_t>(grain, 1);
+        std::size_t chunks = (n + grain - 1) / grain;
+        if (chunks == 0)
+            return;
+        if (chunks == 1 || size() == 1) {
+            for (std::size_t begin = 0; begin < n; begin += grain)
+                f(begin, std::min(n, begin + grain));
+            return;
+        }
+
+        Group group;
+        group.pending.store(chunks, std::memory_order_relaxed);
+
+        auto run = [](void *ctx, std::size_t begin, std::size_t end) {
+            (*static_cast<std::remove_reference_t<F> *>(ctx))(begin, end);
+        };
+
+        void *ctx = const_cast<void *>(static_cast<const void *>(&f));
+
+        // spread the chunks over all deques so that every worker starts without stealing;
+        // `queued` goes up first so that it never undercounts
+        unsigned self = current_index();
+        queued.fetch_add(chunks, std::memory_order_release);
+        for (std::size_t i = 0; i < chunks; i++) {
+            Queue &queue = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> guard{queue.lock};
+            queue.tasks.push_back(Task{run, ctx, i * grain, std::min(n, (i + 1) * grain), &group});
+        }
+        {
+            std::lock_guard<std::mutex> guard{sleep_lock};
+        }
+        wake.notify_all();
+
+        while (group.pending.load(std::memory_order_acquire) != 0) {
+            Task task;
+            if (find_task(self, task))
+                execute(task);
+            else
+                std::this_thread::yield();
+        }
+
+        if (group.error)
+            std::rethrow_exception(group.error);
+    }
+
+private:
+    struct Group {
+        std::atomic<std::size_t> pending;
+        std::mutex error_lock;
+        std::exception_ptr error;
+    };
+
+    struct Task {
+        void (*run)(void *ctx, std::size_t begin, std::size_t end);
+        void *ctx;
+        std::size_t begin;
+        std::size_t end;
+        Group *group;
+    };
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;// queues[0] is shared by threads outside the pool
+    std::vector<std::thread> workers;
+
+    std::atomic<std::size_t> queued{0};
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    bool stop = false;
+
+    // which pool the current thread works for, and its deque there
+    static inline thread_local const ThreadPool *current_pool = nullptr;
+    static inline thread_local unsigned current_queue = 0;
+
+    unsigned current_index() const {
+        return current_pool == this ? current_queue : 0;
+    }
+
+    bool find_task(unsigned self, Task &out) {
+        if (queued.load(std::memory_order_acquire) == 0)
+            return false;
+
+        {
+            Queue &own = *queues[self];
+            std::lock_guard<std::mutex> guard{own.lock};
+            if (!own.tasks.empty()) {
+                out = own.tasks.back();
+                own.tasks.pop_back();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        for (std::size_t i = 1; i < queues.size(); i++) {
+            Queue &victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> guard{victim.lock};
+            if (!victim.tasks.empty()) {
+                out = victim.tasks.front();
+                victim.tasks.pop_front();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static void execute(const Task &task) {
+        try {
+            task.run(task.ctx, task.begin, task.end);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard{task.group->error_lock};
+            if (!task.group->error)
+                task.group->error = std::current_exception();
+        }
+        task.group->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    void work(unsigned index) {
+        current_pool = this;
+        current_queue = index;
+
+        while (true) {
+            Task task;
+            if (find_task(index, task)) {
+                execute(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> guard{sleep_lock};
+            wake.wait(guard, [this] { return stop || queued.load(std::memory_order_acquire) != 0; });
+            if (stop)
+                return;
+        }
+    }
+};
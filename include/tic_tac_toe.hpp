@@ -1,11 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <numeric>
+#include <stdexcept>
 #include <vector>
 
+#include "thread_pool.hpp"
+
 typedef uint_fast16_t T3Bitboard;
 typedef uint_fast8_t T3Square;
 
@@ -42,6 +48,271 @@ enum class T3State : uint_fast8_t {
     O_WIN
 };
 
+constexpr T3Bitboard T3_SQUARES = 0x1FF;
+constexpr T3Bitboard T3_LINES[8] = {0x7, 0x38, 0x1c0, 0x49, 0x92, 0x124, 0x111, 0x54};
+
+// Positions by a base-3 perfect index, one trit per square (empty, x, o), times two for the
+// side to move. Most of the 3^9 boards are unreachable, but indexing needs no hashing.
+constexpr uint32_t T3_POSITIONS = 19683 * 2;
+
+namespace t3_detail {
+
+// the base-3 number with a 1 wherever the mask has a bit
+struct Ternary {
+    uint16_t of[512]{};
+
+    constexpr Ternary() {
+        for (uint32_t mask = 0; mask < 512; mask++)
+            for (uint32_t sq = 9, pow = 6561; sq-- > 0; pow /= 3)
+                if (mask >> sq & 1)
+                    of[mask] = static_cast<uint16_t>(of[mask] + pow);
+    }
+};
+
+constexpr Ternary TERNARY{};
+
+}// namespace t3_detail
+
+constexpr inline uint32_t t3_board_index(T3Bitboard x, T3Bitboard o) {
+    return t3_detail::TERNARY.of[x & T3_SQUARES] + 2u * t3_detail::TERNARY.of[o & T3_SQUARES];
+}
+
+constexpr inline uint32_t t3_index(T3Bitboard x, T3Bitboard o, bool x_turn) {
+    return t3_board_index(x, o) * 2u + x_turn;
+}
+
+// Boards that no rotation or reflection turns into one with a smaller t3_board_index(), by
+// Burnside's lemma (3^9 + 2 * 3^3 + 3^5 + 4 * 3^6) / 8 of them.
+constexpr uint32_t T3_CANONICAL_BOARDS = 2862;
+constexpr uint32_t T3_CANONICAL_POSITIONS = T3_CANONICAL_BOARDS * 2;
+
+namespace t3_detail {
+
+// The 8 symmetries of the board as permutations of the squares, and of bitboards by lookup
+struct Symmetries {
+    T3Square square[8][9]{};
+    uint16_t board[8][512]{};
+    uint8_t inverse[8] = {0, 3, 2, 1, 4, 5, 6, 7};
+
+    constexpr Symmetries() {
+        for (int sq = 0; sq < 9; sq++) {
+            int r = sq / 3, c = sq % 3;
+            // identity, rotations by 90, 180 and 270 degrees, and the four reflections
+            const int to[8][2] = {{r, c}, {c, 2 - r}, {2 - r, 2 - c}, {2 - c, r}, {r, 2 - c}, {2 - r, c}, {c, r}, {2 - c, 2 - r}};
+            for (int s = 0; s < 8; s++)
+                square[s][sq] = static_cast<T3Square>(to[s][0] * 3 + to[s][1]);
+        }
+        for (int s = 0; s < 8; s++)
+            for (uint32_t mask = 0; mask < 512; mask++)
+                for (int sq = 0; sq < 9; sq++)
+                    if (mask >> sq & 1)
+                        board[s][mask] = static_cast<uint16_t>(board[s][mask] | 1u << square[s][sq]);
+    }
+};
+
+constexpr Symmetries SYMMETRIES{};
+
+// the canonical boards by ascending t3_board_index()
+struct CanonicalBoards {
+    uint16_t index[T3_CANONICAL_BOARDS]{};
+
+    constexpr CanonicalBoards() {
+        uint32_t n = 0;
+        for (uint32_t b = 0; b < 19683; b++) {
+            T3Bitboard x = 0, o = 0;
+            for (uint32_t sq = 0, rest = b; sq < 9; sq++, rest /= 3) {
+                if (rest % 3 == 1)
+                    x |= 1u << sq;
+                else if (rest % 3 == 2)
+                    o |= 1u << sq;
+            }
+
+            bool canonical = true;
+            for (int s = 1; s < 8 && canonical; s++)
+                canonical = t3_board_index(SYMMETRIES.board[s][x], SYMMETRIES.board[s][o]) >= b;
+            if (canonical) {
+                if (n == T3_CANONICAL_BOARDS)
+                    throw std::logic_error{"T3_CANONICAL_BOARDS is wrong"};
+                index[n++] = static_cast<uint16_t>(b);
+            }
+        }
+        if (n != T3_CANONICAL_BOARDS)
+            throw std::logic_error{"T3_CANONICAL_BOARDS is wrong"};
+    }
+};
+
+constexpr CanonicalBoards CANONICAL_BOARDS{};
+
+}// namespace t3_detail
+
+// where square sq goes under one of the 8 symmetries, and back
+constexpr inline T3Square t3_map_square(T3Square sq, uint8_t symmetry) {
+    return t3_detail::SYMMETRIES.square[symmetry][sq];
+}
+
+constexpr inline T3Square t3_unmap_square(T3Square sq, uint8_t symmetry) {
+    return t3_detail::SYMMETRIES.square[t3_detail::SYMMETRIES.inverse[symmetry]][sq];
+}
+
+// the canonical form of a board: `symmetry` maps the board onto (x, o)
+struct T3Canonical {
+    T3Bitboard x, o;
+    uint8_t symmetry;
+};
+
+constexpr inline T3Canonical t3_canonical(T3Bitboard x, T3Bitboard o) {
+    T3Canonical ret{x, o, 0};
+    uint32_t least = t3_board_index(x, o);
+    for (uint8_t s = 1; s < 8; s++) {
+        T3Bitboard sx = t3_detail::SYMMETRIES.board[s][x & T3_SQUARES], so = t3_detail::SYMMETRIES.board[s][o & T3_SQUARES];
+        uint32_t index = t3_board_index(sx, so);
+        if (index < least) {
+            least = index;
+            ret = {sx, so, s};
+        }
+    }
+    return ret;
+}
+
+// Dense index of a position among the canonical ones, below T3_CANONICAL_POSITIONS; all
+// symmetric positions share it.
+constexpr inline uint32_t t3_canonical_index(T3Bitboard x, T3Bitboard o, bool x_turn) {
+    T3Canonical c = t3_canonical(x, o);
+    uint32_t key = t3_board_index(c.x, c.o), lo = 0, hi = T3_CANONICAL_BOARDS;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (t3_detail::CANONICAL_BOARDS.index[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo * 2 + x_turn;
+}
+
+constexpr inline bool t3_has_line(T3Bitboard bb) {
+    for (T3Bitboard line: T3_LINES)
+        if ((bb & line) == line)
+            return true;
+    return false;
+}
+
+// Scores are from the side to move, with wins sooner worth more: eval() gives a win k plies
+// below the root of the search, at `depth`, as 10 - depth - k. The tables store them relative
+// to the position itself, as 10 - k, and these convert between the two.
+constexpr inline Score t3_at_depth(Score relative, BasicInt depth) {
+    return relative > 0 ? relative - depth : relative < 0 ? relative + depth : 0;
+}
+
+constexpr inline Score t3_relative(Score score, BasicInt depth) {
+    return score > 0 ? score + depth : score < 0 ? score - depth : 0;
+}
+
+// Every position solved, terminal ones included: a line for the side that just moved is a
+// loss, a full board a draw. Only canonical positions are stored. Construction is constexpr,
+// so the table can be built by the compiler (see t3_solved()).
+class T3Solved {
+public:
+    constexpr T3Solved() {
+        for (uint32_t i = 0; i < T3_CANONICAL_POSITIONS; i++)
+            scores[i] = UNSOLVED;
+        for (uint32_t b = 0; b < T3_CANONICAL_BOARDS; b++) {
+            T3Bitboard x = 0, o = 0;
+            for (uint32_t sq = 0, rest = t3_detail::CANONICAL_BOARDS.index[b]; sq < 9; sq++, rest /= 3) {
+                if (rest % 3 == 1)
+                    x |= 1u << sq;
+                else if (rest % 3 == 2)
+                    o |= 1u << sq;
+            }
+            solve(x, o, false);
+            solve(x, o, true);
+        }
+    }
+
+    // relative to the position, see t3_relative()
+    [[nodiscard]] constexpr Score score(T3Bitboard x, T3Bitboard o, bool x_turn) const {
+        return scores[t3_canonical_index(x, o, x_turn)];
+    }
+
+private:
+    constexpr static int8_t UNSOLVED = std::numeric_limits<int8_t>::min();
+
+    std::array<int8_t, T3_CANONICAL_POSITIONS> scores{};
+
+    constexpr int8_t solve(T3Bitboard x, T3Bitboard o, bool x_turn) {
+        int8_t &slot = scores[t3_canonical_index(x, o, x_turn)];
+        if (slot != UNSOLVED)
+            return slot;
+
+        T3Bitboard own = x_turn ? x : o, other = x_turn ? o : x;
+        int8_t ret = 0;
+        if (t3_has_line(other))
+            ret = -10;
+        else if (t3_has_line(own))
+            ret = 10;
+        else if ((x | o) == T3_SQUARES)
+            ret = 0;
+        else {
+            ret = -10;
+            for (T3Square sq = 0; sq < 9; sq++) {
+                if ((x | o) & to_bb(sq))
+                    continue;
+                Score child = x_turn ? solve(x | to_bb(sq), o, false) : solve(x, o | to_bb(sq), true);
+                ret = std::max(ret, static_cast<int8_t>(-t3_at_depth(child, 1)));
+            }
+        }
+        return slot = ret;
+    }
+};
+
+// The solved table, built on first use, or by the compiler with T3_SOLVE_AT_COMPILE_TIME.
+inline const T3Solved &t3_solved() {
+#ifdef T3_SOLVE_AT_COMPILE_TIME
+    static constexpr T3Solved table{};
+#else
+    static const T3Solved table{};
+#endif
+    return table;
+}
+
+// Transposition table for eval(): exact scores and the bounds a cutoff leaves, by
+// t3_canonical_index(), so symmetric positions share an entry. The index is perfect, so
+// entries need no key. An entry is one atomic word, so searches on several threads can share
+// the table without locks.
+class T3TransTable {
+public:
+    enum Bound : uint8_t {
+        NONE,
+        EXACT,
+        LOWER,
+        UPPER
+    };
+
+    struct Entry {
+        int8_t score;// relative to the position
+        Bound bound;
+    };
+
+    T3TransTable() { clear(); }
+
+    Entry load(T3Bitboard x, T3Bitboard o, bool x_turn) const {
+        uint16_t bits = entries[t3_canonical_index(x, o, x_turn)].load(std::memory_order_relaxed);
+        return {static_cast<int8_t>(bits & 0xFF), static_cast<Bound>(bits >> 8)};
+    }
+
+    void store(T3Bitboard x, T3Bitboard o, bool x_turn, Entry entry) {
+        uint16_t bits = static_cast<uint16_t>(static_cast<uint8_t>(entry.score) | entry.bound << 8);
+        entries[t3_canonical_index(x, o, x_turn)].store(bits, std::memory_order_relaxed);
+    }
+
+    void clear() {
+        for (auto &entry: entries)
+            entry.store(NONE << 8, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint16_t>, T3_CANONICAL_POSITIONS> entries;
+};
+
 class TicTacToe {
 public:
     T3Bitboard x = 0, o = 0;
@@ -52,8 +323,14 @@ public:
     T3State state = T3State::ONGOING;
 
     std::vector<T3Square> best;
-    double expected_activation[9];
-    Score scores[9];
+    double expected_activation[9]{};
+    Score scores[9]{};
+
+    // gen_best_moves() looks moves up in `solved` if set; otherwise eval() searches, with
+    // `table` if set, on the threads of `pool` if set. None is owned.
+    const T3Solved *solved = nullptr;
+    T3TransTable *table = nullptr;
+    ThreadPool *pool = nullptr;
 
     constexpr inline T3Bitboard &current_bb() {
         return is_x_turn ? x : o;
@@ -112,22 +389,39 @@ public:
     inline Score eval(Score alpha, Score beta) {
         switch (state) {
             case (T3State::ONGOING): {
+                Score alpha_in = alpha;
+                if (table) {
+                    T3TransTable::Entry entry = table->load(x, o, is_x_turn);
+                    Score stored = t3_at_depth(entry.score, depth);
+                    if (entry.bound == T3TransTable::EXACT)
+                        return stored;
+                    if (entry.bound == T3TransTable::LOWER)
+                        alpha = std::max(alpha, stored);
+                    else if (entry.bound == T3TransTable::UPPER)
+                        beta = std::min(beta, stored);
+                    if (entry.bound != T3TransTable::NONE && alpha >= beta)
+                        return stored;
+                }
 
                 Score value = SCORE_MIN;
                 for (T3Square mov = 0; mov < 9; mov++) {
                     if (!is_legal(mov)) continue;
                     make_move(mov);
                     depth++;
-                    value = std::max((int16_t) value, (int16_t) -eval(-beta, -alpha));
+                    value = std::max(value, -eval(-beta, -alpha));
                     depth--;
                     unmake_move(mov);
 
-                    if (value > beta)
-                        return value;
+                    if (value >= beta)
+                        break;
 
                     alpha = std::max(value, alpha);
                 }
 
+                if (table) {
+                    T3TransTable::Bound bound = value <= alpha_in ? T3TransTable::UPPER : value >= beta ? T3TransTable::LOWER : T3TransTable::EXACT;
+                    table->store(x, o, is_x_turn, {static_cast<int8_t>(t3_relative(value, depth)), bound});
+                }
                 return value;
             }
             case (T3State::DRAW):
@@ -141,11 +435,53 @@ public:
         throw std::runtime_error{"What?"};
     }
 
+    // The score of every legal move, exactly, and the moves with the best one. Illegal moves
+    // score -64. Moves that a symmetry of the position maps onto each other score the same,
+    // so only the first of each such group is searched. With a pool, those searches run in
+    // parallel, each on its own copy of the board; every score is exact, so the result does
+    // not depend on the number of threads.
     inline Score gen_best_moves() {
         Score alpha = SCORE_MIN;
         depth = 0;
         best.clear();
 
+        uint8_t symmetric[8], symmetries = 0;
+        for (uint8_t s = 1; s < 8; s++)
+            if (t3_detail::SYMMETRIES.board[s][x] == x && t3_detail::SYMMETRIES.board[s][o] == o)
+                symmetric[symmetries++] = s;
+
+        T3Square first[9], searched[9];
+        Score found[9];// not into `scores`, which the searches copy along with the board
+        std::size_t count = 0;
+        for (T3Square mov = 0; mov < 9; mov++) {
+            first[mov] = mov;
+            for (uint8_t i = 0; i < symmetries; i++)
+                first[mov] = std::min(first[mov], t3_map_square(mov, symmetric[i]));
+            if (is_legal(mov) && first[mov] == mov)
+                searched[count++] = mov;
+        }
+
+        auto search = [&](std::size_t begin, std::size_t end) {
+            TicTacToe copy = *this;
+            for (std::size_t i = begin; i < end; i++) {
+                T3Square mov = searched[i];
+                if (solved) {
+                    bool x_moves = is_x_turn;
+                    found[mov] = -t3_at_depth(solved->score(x_moves ? x | to_bb(mov) : x, x_moves ? o : o | to_bb(mov), !x_moves), 1);
+                } else {
+                    copy.make_move(mov);
+                    copy.depth++;
+                    found[mov] = -copy.eval(SCORE_MIN, SCORE_MAX);
+                    copy.depth--;
+                    copy.unmake_move(mov);
+                }
+            }
+        };
+        if (pool && !solved)
+            pool->parallel_for(count, 1, search);
+        else
+            search(0, count);
+
         for (T3Square mov = 0; mov < 9; mov++) {
             expected_activation[mov] = 0.0;
             if (!is_legal(mov)) {
@@ -153,13 +489,8 @@ public:
                 continue;
             }
 
-            make_move(mov);
-            depth++;
-            Score val = -eval(SCORE_MIN, -alpha);
+            Score val = found[first[mov]];
             scores[mov] = val;
-            depth--;
-            // std::cout << "info move " << (int) mov << " score " << (int) val << '\n';
-            unmake_move(mov);
 
             if (val > alpha) {
                 best.clear();
@@ -180,6 +511,105 @@ public:
     }
 };
 
-std::size_t hash_tictactoe(const TicTacToe &rhs) {
+inline std::size_t hash_tictactoe(const TicTacToe &rhs) {
     return static_cast<uint64_t>(rhs.x) << 1 | static_cast<uint64_t>(rhs.o) << 10 | (rhs.is_x_turn ? 1ULL : 0ULL);
 }
+
+// Positions and their labels as structure of arrays, for generating training data. Position
+// i is (x[i], o[i], x_turn[i]); its labels are the 9 entries from i * 9 of `scores` and
+// `activation`, as TicTacToe::gen_best_moves() leaves them in scores and expected_activation,
+// and value[i], the best of them, or -64 without a legal move.
+struct T3Batch {
+    std::vector<uint16_t> x, o;
+    std::vector<uint8_t> x_turn;
+
+    std::vector<int8_t> scores;
+    std::vector<float> activation;
+    std::vector<int8_t> value;
+
+    [[nodiscard]] std::size_t size() const { return x.size(); }
+
+    void push_back(T3Bitboard x_bb, T3Bitboard o_bb, bool turn) {
+        x.push_back(static_cast<uint16_t>(x_bb));
+        o.push_back(static_cast<uint16_t>(o_bb));
+        x_turn.push_back(turn);
+    }
+};
+
+// positions per task in t3_evaluate()
+constexpr std::size_t T3_BATCH_CHUNK = 1024;
+
+namespace t3_detail {
+
+// The solved table unfolded by t3_index(), which saves t3_evaluate() finding the canonical
+// form of every child; at 39 kB it still fits in L2.
+inline const std::vector<int8_t> &unfolded_scores() {
+    static const std::vector<int8_t> table = [] {
+        const T3Solved &solved = t3_solved();
+        std::vector<int8_t> ret(T3_POSITIONS);
+        for (T3Bitboard x = 0; x <= T3_SQUARES; x++)
+            for (T3Bitboard o = 0; o <= T3_SQUARES; o++)
+                if (!(x & o)) {
+                    ret[t3_index(x, o, false)] = static_cast<int8_t>(solved.score(x, o, false));
+                    ret[t3_index(x, o, true)] = static_cast<int8_t>(solved.score(x, o, true));
+                }
+        return ret;
+    }();
+    return table;
+}
+
+}// namespace t3_detail
+
+// Labels every position of the batch from the solved table, on the threads of `pool` if set
+inline void t3_evaluate(T3Batch &batch, ThreadPool *pool = nullptr) {
+    std::size_t n = batch.size();
+    if (batch.o.size() != n || batch.x_turn.size() != n)
+        throw std::runtime_error{"Batch arrays differ in length"};
+    batch.scores.resize(n * 9);
+    batch.activation.resize(n * 9);
+    batch.value.resize(n);
+
+    const int8_t *solved = t3_detail::unfolded_scores().data();
+    auto label = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            T3Bitboard x = batch.x[i], o = batch.o[i];
+            bool x_turn = batch.x_turn[i];
+            if ((x | o) > T3_SQUARES || (x & o))
+                throw std::runtime_error{"Invalid position"};
+
+            int8_t *scores = &batch.scores[i * 9], best = -64;
+            for (T3Square sq = 0; sq < 9; sq++) {
+                if ((x | o) & to_bb(sq)) {
+                    scores[sq] = -64;
+                    continue;
+                }
+                Score child = x_turn ? solved[t3_index(x | to_bb(sq), o, false)] : solved[t3_index(x, o | to_bb(sq), true)];
+                scores[sq] = static_cast<int8_t>(-t3_at_depth(child, 1));
+                best = std::max(best, scores[sq]);
+            }
+
+            float *activation = &batch.activation[i * 9];
+            for (T3Square sq = 0; sq < 9; sq++)
+                activation[sq] = best != -64 && scores[sq] == best ? 1.0f : 0.0f;
+            batch.value[i] = best;
+        }
+    };
+
+    if (pool)
+        pool->parallel_for(n, T3_BATCH_CHUNK, label);
+    else
+        label(0, n);
+}
+
+// Every position TicTacToe can reach with the game still on, by ascending (o, x)
+inline T3Batch t3_reachable() {
+    T3Batch ret;
+    for (T3Bitboard o = 0; o <= T3_SQUARES; o++)
+        for (T3Bitboard x = 0; x <= T3_SQUARES; x++) {
+            int nx = __builtin_popcount(static_cast<unsigned>(x)), no = __builtin_popcount(static_cast<unsigned>(o));
+            if ((x & o) || (nx != no && nx != no + 1) || t3_has_line(x) || t3_has_line(o) || nx + no == 9)
+                continue;
+            ret.push_back(x, o, nx == no);
+        }
+    return ret;
+}
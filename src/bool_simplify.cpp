@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boolalg/bdd.hpp"
+#include "boolalg/minimize.hpp"
+#include "boolalg/sat.hpp"
+#include "boolalg/text.hpp"
+#include "boolalg/truth_table.hpp"
+#include "thread_pool.hpp"
+
+// Simplifies a stream of formulas, one per line, in the syntax of boolalg/text.hpp. Lines are
+// read in batches, each batch is simplified across all threads, and the results are written
+// in input order, so memory stays bounded however long the input is. A line that does not
+// parse comes out as "error: ..." and makes the exit code non-zero.
+//
+// modes: expand   - sum of products, as far as the term budget allows
+//        minimize - expand, then two-level minimization (the default)
+//        bdd      - if-then-else form of the BDD after sifting
+//
+// With -c every result is checked against its input, by comparing their truth tables or,
+// over more than CHECK_TABLE_VARS variables, by asking the SAT solver for an assignment on
+// which they differ. A result that differs comes out as "error: ..." as well.
+//
+// usage: BoolSimplify [-j threads] [-m mode] [-c] [input [output]]    ("-" or nothing: stdin/stdout)
+
+constexpr std::size_t BATCH_LINES = 16384;
+constexpr std::size_t CHUNK_LINES = 64;// per task; every task gets a fresh ExprPool
+constexpr std::size_t CHECK_TABLE_VARS = 20;
+
+enum class Mode {
+    EXPAND,
+    MINIMIZE,
+    BDD
+};
+
+static BoolNodeId simplify(ExprPool &pool, BoolNodeId id, Mode mode) {
+    switch (mode) {
+        case Mode::EXPAND:
+            return pool.expand(id);
+        case Mode::MINIMIZE:
+            return minimize(pool, id);
+        case Mode::BDD: {
+            BddManager mgr;
+            Bdd f = mgr.from_expr(pool, id);
+            mgr.reorder();
+            return mgr.to_expr(pool, f);
+        }
+    }
+    return id;
+}
+
+// whether result is the same function as input
+static bool check(ExprPool &pool, BoolNodeId input, BoolNodeId result) {
+    if (Tape::support(pool, {input, result}).size() <= CHECK_TABLE_VARS)
+        return equivalent(pool, input, result);
+    BoolNodeId differ = pool.disj(pool.conj(input, pool.negate(result)), pool.conj(pool.negate(input), result));
+    return !satisfiable(pool, differ);
+}
+
+static void usage() {
+    std::fprintf(stderr, "usage: BoolSimplify [-j threads] [-m expand|minimize|bdd] [-c] [input [output]]\n");
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    Mode mode = Mode::MINIMIZE;
+    bool checked = false;
+    std::vector<const char *> files;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            if (std::strcmp(name, "expand") == 0)
+                mode = Mode::EXPAND;
+            else if (std::strcmp(name, "minimize") == 0)
+                mode = Mode::MINIMIZE;
+            else if (std::strcmp(name, "bdd") == 0)
+                mode = Mode::BDD;
+            else
+                usage();
+        } else if (std::strcmp(argv[i], "-c") == 0) {
+            checked = true;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage();
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.size() > 2)
+        usage();
+
+    std::ios::sync_with_stdio(false);
+    std::ifstream file_in;
+    std::istream *in = &std::cin;
+    if (!files.empty() && std::strcmp(files[0], "-") != 0) {
+        file_in.open(files[0]);
+        if (!file_in) {
+            std::fprintf(stderr, "cannot open %s\n", files[0]);
+            return EXIT_FAILURE;
+        }
+        in = &file_in;
+    }
+
+    std::FILE *out = stdout;
+    if (files.size() > 1 && std::strcmp(files[1], "-") != 0) {
+        out = std::fopen(files[1], "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot open %s\n", files[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ThreadPool pool{threads};
+    std::vector<std::string> lines(BATCH_LINES);
+    std::vector<std::string> results((BATCH_LINES + CHUNK_LINES - 1) / CHUNK_LINES);
+    std::atomic<std::size_t> errors{0};
+    std::size_t total = 0, first_line = 1;
+    auto start = std::chrono::steady_clock::now();
+
+    for (bool more = true; more;) {
+        std::size_t n = 0;
+        while (n < BATCH_LINES && std::getline(*in, lines[n]))
+            n++;
+        more = n == BATCH_LINES;
+
+        pool.parallel_for(n, CHUNK_LINES, [&](std::size_t begin, std::size_t end) {
+            ExprPool exprs;
+            std::string &buf = results[begin / CHUNK_LINES];
+            buf.clear();
+            for (std::size_t i = begin; i < end; i++) {
+                try {
+                    if (lines[i].find_first_not_of(" \t\r") != std::string::npos) {
+                        BoolNodeId input = parse(exprs, lines[i]);
+                        BoolNodeId result = simplify(exprs, input, mode);
+                        if (checked && !check(exprs, input, result))
+                            throw std::runtime_error{"result differs from the input: " + exprs.to_string(result)};
+                        write(exprs, result, buf);
+                    }
+                } catch (const std::runtime_error &e) {
+                    buf += "error: ";
+                    buf += e.what();
+                    errors.fetch_add(1, std::memory_order_relaxed);
+                    std::fprintf(stderr, "line %zu: %s\n", first_line + i, e.what());
+                }
+                buf += '\n';
+            }
+        });
+
+        for (std::size_t c = 0; c * CHUNK_LINES < n; c++)
+            std::fwrite(results[c].data(), 1, results[c].size(), out);
+        total += n;
+        first_line += n;
+    }
+
+    if (out != stdout)
+        std::fclose(out);
+    else
+        std::fflush(out);
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%zu formulas, %zu errors, %.3f s, %u threads\n", total, errors.load(), secs, threads);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
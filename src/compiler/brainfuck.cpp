@@ -3,6 +3,7 @@
 struct RetInfo {
     llvm::BasicBlock *header, *body;
     uint64_t loop_no;
+    std::size_t source;// index of the '['
 };
 
 void Parser::brainfuck() {
@@ -54,12 +55,14 @@ void Parser::brainfuck() {
 
                 builder.SetInsertPoint(body);
 
-                loop_ret_addrs.emplace_back(RetInfo{header, body, loop_counter++});
+                loop_ret_addrs.emplace_back(RetInfo{header, body, loop_counter++, ind});
                 break;
             }
             case ']': {
-                if (loop_ret_addrs.empty())
+                if (loop_ret_addrs.empty()) {
                     emit_error("Unmatched ']': No loop to close");
+                    break;
+                }
                 auto ret = loop_ret_addrs.back();
 
                 llvm::BasicBlock *cont = llvm::BasicBlock::Create(*ctx, "loop_continue" + std::to_string(ret.loop_no), main);
@@ -107,8 +110,11 @@ void Parser::brainfuck() {
         ind++;
     }
 
-    if (!loop_ret_addrs.empty())
-        emit_error("Unmatched '[': Loop not closed!");
+    for (const auto &loop: loop_ret_addrs)
+        emit_error(static_cast<uint32_t>(loop.source), static_cast<uint32_t>(loop.source + 1), "Unmatched '[': Loop not closed!");
+
+    if (diag.has_errors())
+        return;
 
 
     builder.CreateRet(builder.getInt32(0));
@@ -0,0 +1,662 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lingalg.hpp"
+#include "lingalg/batch.hpp"
+#include "lingalg/sparse.hpp"
+
+// Single-threaded speed and accuracy of the fixed-size Matrix operations, for every
+// combination of operation, scalar type and size. Every result is checked against the same
+// computation in long double; integer results must match exactly. The exit code is non-zero
+// if any check fails, so the bench doubles as a regression check after kernel changes.
+// Last, the results of the constant-evaluation paths are compared against the runtime ones,
+// and conjugate_gradient() on sparse systems against DynMatrix::solve().
+//
+// invert and rref are only measured for floating-point types: integer division truncates.
+// So are batch_invert() and batch_solve(), for n up to BATCH_MAX_N; their times are per matrix.
+//
+// usage: LingalgBench [ms per measurement]
+
+using Sizes = std::integer_sequence<unsigned, 2, 3, 4, 8, 16, 32, 64>;
+
+constexpr unsigned BATCH_MAX_N = 16;
+constexpr std::size_t BATCH_COUNT = 64 * lingalg_detail::BATCH_BLOCK + 3;// ends in a partial block
+
+static double min_secs = 0.005;
+static bool all_ok = true;
+
+template<typename T>
+static const char *type_name() {
+    if constexpr (std::is_same_v<T, float>)
+        return "float";
+    else if constexpr (std::is_same_v<T, double>)
+        return "double";
+    else
+        return "int";
+}
+
+// keeps the optimizer from hoisting work out of the timing loop or dropping it
+template<typename V>
+static void escape(V &v) {
+    asm volatile("" : : "g"(&v) : "memory");
+}
+
+// best of 5 runs of enough iterations to take min_secs, in ns per iteration
+template<typename F>
+static double ns_per_op(F &&f) {
+    using clock = std::chrono::steady_clock;
+    auto run = [&](std::size_t iters) {
+        auto start = clock::now();
+        for (std::size_t i = 0; i < iters; i++)
+            f();
+        return std::chrono::duration<double>(clock::now() - start).count();
+    };
+
+    std::size_t iters = 1;
+    while (run(iters) < min_secs)
+        iters *= 2;
+
+    double best = 1e300;
+    for (int i = 0; i < 5; i++)
+        best = std::min(best, run(iters));
+    return best / static_cast<double>(iters) * 1e9;
+}
+
+// The largest error the check lets through. The inputs are well conditioned (see
+// random_matrix()), so the error should grow about linearly with n.
+template<typename T>
+static double tolerance(unsigned n) {
+    if constexpr (std::is_integral_v<T>)
+        return 0;
+    else
+        return 64.0 * n * std::numeric_limits<T>::epsilon();
+}
+
+static void report(const char *op, const char *type, unsigned n, double ns, double flops, double err, double tol) {
+    bool ok = err <= tol;
+    all_ok = all_ok && ok;
+
+    char gflops[32] = "-";
+    if (flops > 0)
+        std::snprintf(gflops, sizeof(gflops), "%.2f", flops / ns);
+
+    std::printf("%-10s %-7s %4u %12.1f %9s %12.3g %s\n", op, type, n, ns, gflops, err, ok ? "ok" : "FAIL");
+}
+
+using Ref = std::vector<long double>;// row-major
+
+template<typename T, unsigned R, unsigned C>
+static Ref to_ref(const Matrix<T, R, C> &m) {
+    Ref ret(R * C);
+    for (unsigned r = 0; r < R; r++)
+        for (unsigned c = 0; c < C; c++)
+            ret[r * C + c] = m[r][c];
+    return ret;
+}
+
+// max |m - ref| relative to max |ref|
+template<typename T, unsigned R, unsigned C>
+static double error(const Matrix<T, R, C> &m, const Ref &ref) {
+    long double diff = 0, scale = 0;
+    for (unsigned r = 0; r < R; r++)
+        for (unsigned c = 0; c < C; c++) {
+            diff = std::max(diff, std::fabs(m[r][c] - ref[r * C + c]));
+            scale = std::max(scale, std::fabs(ref[r * C + c]));
+        }
+    return static_cast<double>(scale > 0 ? diff / scale : diff);
+}
+
+static double error(long double x, long double ref) {
+    return static_cast<double>(ref != 0 ? std::fabs(x - ref) / std::fabs(ref) : std::fabs(x));
+}
+
+static Ref ref_multiply(const Ref &a, const Ref &b, unsigned n) {
+    Ref ret(n * n);
+    for (unsigned r = 0; r < n; r++)
+        for (unsigned c = 0; c < n; c++) {
+            long double sum = 0;
+            for (unsigned p = 0; p < n; p++)
+                sum += a[r * n + p] * b[p * n + c];
+            ret[r * n + c] = sum;
+        }
+    return ret;
+}
+
+// Gauss-Jordan with partial pivoting on a rows x cols matrix, to reduced row echelon form.
+// Also returns the determinant of the leading square part.
+static long double ref_rref(Ref &a, unsigned rows, unsigned cols) {
+    long double det = 1;
+    for (unsigned k = 0; k < rows; k++) {
+        unsigned pivot = k;
+        for (unsigned i = k + 1; i < rows; i++)
+            if (std::fabs(a[i * cols + k]) > std::fabs(a[pivot * cols + k]))
+                pivot = i;
+        if (pivot != k) {
+            for (unsigned j = 0; j < cols; j++)
+                std::swap(a[k * cols + j], a[pivot * cols + j]);
+            det = -det;
+        }
+
+        long double div = a[k * cols + k];
+        det *= div;
+        for (unsigned j = 0; j < cols; j++)
+            a[k * cols + j] /= div;
+        for (unsigned i = 0; i < rows; i++) {
+            long double f = a[i * cols + k];
+            if (i != k)
+                for (unsigned j = 0; j < cols; j++)
+                    a[i * cols + j] -= f * a[k * cols + j];
+        }
+    }
+    return det;
+}
+
+template<typename T, unsigned R, unsigned C>
+static Matrix<T, R, C> random_matrix(std::mt19937 &rng) {
+    Matrix<T, R, C> ret{};
+    if constexpr (std::is_integral_v<T>) {
+        std::uniform_int_distribution<int> dist{-3, 3};
+        for (unsigned r = 0; r < R; r++)
+            for (unsigned c = 0; c < C; c++)
+                ret[r][c] = static_cast<T>(dist(rng));
+    } else {
+        // Off-diagonal noise of this size keeps the eigenvalues within about 0.6 of 1, so the
+        // condition number and the determinant stay modest at every size.
+        T noise = T{1} / std::sqrt(static_cast<T>(C));
+        std::uniform_real_distribution<T> dist{-noise, noise};
+        for (unsigned r = 0; r < R; r++)
+            for (unsigned c = 0; c < C; c++)
+                ret[r][c] = dist(rng) + (r == c ? T{1} : T{0});
+    }
+    return ret;
+}
+
+// A shuffled block diagonal of 2x2 blocks with +-1 on the diagonal and determinant +-1. Every
+// minor Bareiss elimination passes through is a product of block minors, so the integer
+// determinant stays exact and free of overflow at any size.
+template<typename T, unsigned N>
+static Matrix<T, N, N> unimodular_matrix(std::mt19937 &rng) {
+    const int blocks[][2][2] = {{{1, 1}, {0, 1}}, {{1, 0}, {-1, 1}}, {{1, 1}, {-2, -1}}, {{-1, 2}, {1, -1}}};
+
+    Matrix<T, N, N> block{};
+    for (unsigned i = 0; i + 1 < N; i += 2) {
+        const auto &b = blocks[rng() % 4];
+        for (unsigned r = 0; r < 2; r++)
+            for (unsigned c = 0; c < 2; c++)
+                block[i + r][i + c] = static_cast<T>(b[r][c]);
+    }
+    if (N % 2)
+        block[N - 1][N - 1] = 1;
+
+    unsigned perm[N];
+    for (unsigned i = 0; i < N; i++)
+        perm[i] = i;
+    std::shuffle(perm, perm + N, rng);
+
+    Matrix<T, N, N> ret{};
+    for (unsigned r = 0; r < N; r++)
+        for (unsigned c = 0; c < N; c++)
+            ret[r][c] = block[perm[r]][perm[c]];
+    return ret;
+}
+
+// matrices in the structure-of-arrays layout of lingalg/batch.hpp
+template<typename T, unsigned R, unsigned C>
+static std::vector<T> to_soa(const std::vector<Matrix<T, R, C>> &ms) {
+    std::vector<T> ret(R * C * ms.size());
+    for (std::size_t i = 0; i < ms.size(); i++)
+        for (unsigned r = 0; r < R; r++)
+            for (unsigned c = 0; c < C; c++)
+                ret[(r * C + c) * ms.size() + i] = ms[i][r][c];
+    return ret;
+}
+
+template<typename T, unsigned R, unsigned C>
+static Matrix<T, R, C> from_soa(const std::vector<T> &soa, std::size_t count, std::size_t i) {
+    Matrix<T, R, C> ret{};
+    for (unsigned r = 0; r < R; r++)
+        for (unsigned c = 0; c < C; c++)
+            ret[r][c] = soa[(r * C + c) * count + i];
+    return ret;
+}
+
+// BATCH_COUNT systems, every 7th made singular by zeroing a row or a column. Elimination keeps
+// those exactly zero, so unlike a repeated row they are singular after rounding too. Every
+// other lane must match Matrix::inverted() / Matrix::solve() on the same matrix, and
+// singular[] must flag exactly the singular ones.
+template<typename T, unsigned N>
+static void bench_batch(std::mt19937 &rng) {
+    const char *type = type_name<T>();
+    double n = N;
+    std::size_t count = BATCH_COUNT;
+
+    std::vector<Matrix<T, N, N>> ms(count);
+    std::vector<Vector<T, N>> bs(count);
+    for (std::size_t i = 0; i < count; i++) {
+        ms[i] = random_matrix<T, N, N>(rng);
+        bs[i] = random_matrix<T, N, 1>(rng);
+    }
+    // regular matrices only, since a singular lane's garbage would be fed back in
+    std::vector<T> timed = to_soa(ms);
+
+    std::vector<bool> want_singular(count);
+    for (std::size_t i = 3; i < count; i += 7) {
+        want_singular[i] = true;
+        unsigned k = static_cast<unsigned>(i / 14 % N);
+        for (unsigned j = 0; j < N; j++)
+            (i / 7 % 2 ? ms[i][j][k] : ms[i][k][j]) = 0;
+    }
+
+    std::unique_ptr<bool[]> singular{new bool[count]};
+    auto check = [&](const char *op, double ns, double flops, auto &&lane_error) {
+        double err = 0;
+        std::size_t wrong = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            if (singular[i] != want_singular[i])
+                wrong++;
+            else if (!want_singular[i])
+                err = std::max(err, lane_error(i));
+        }
+
+        report(op, type, N, ns, flops, err, tolerance<T>(N));
+        if (wrong > 0) {
+            all_ok = false;
+            std::printf("%-10s %-7s %4u %zu of %zu singular flags wrong\n", op, type, N, wrong, count);
+        }
+    };
+
+    {
+        // inverting the inverse gives the original back, so this needs no fresh input
+        double ns = ns_per_op([&] {
+            batch_invert<T, N>(timed.data(), count, singular.get());
+            escape(timed);
+        });
+
+        std::vector<T> a = to_soa(ms);
+        batch_invert<T, N>(a.data(), count, singular.get());
+        check("batch inv", ns / static_cast<double>(count), 2 * n * n * n, [&](std::size_t i) {
+            Matrix<T, N, N> ref = ms[i].inverted();
+            return error(from_soa<T, N, N>(a, count, i), to_ref(ref));
+        });
+    }
+
+    {
+        // batch_solve() overwrites its inputs, so the time includes copying them back in
+        std::vector<T> a0 = to_soa(ms), b0 = to_soa(bs), a, b;
+        double ns = ns_per_op([&] {
+            a = a0;
+            b = b0;
+            batch_solve<T, N>(a.data(), b.data(), count, singular.get());
+            escape(b);
+        });
+
+        check("batch sol", ns / static_cast<double>(count), 2 * n * n * n / 3, [&](std::size_t i) {
+            Vector<T, N> ref = ms[i].solve(bs[i]);
+            return error(from_soa<T, N, 1>(b, count, i), to_ref(ref));
+        });
+    }
+}
+
+template<typename T, unsigned N>
+static void bench_size() {
+    std::mt19937 rng{N};
+    const char *type = type_name<T>();
+    double n = N;
+
+    Matrix<T, N, N> a = random_matrix<T, N, N>(rng);
+    Matrix<T, N, N> b = random_matrix<T, N, N>(rng);
+
+    {
+        Matrix<T, N, N> c{};
+        double ns = ns_per_op([&] {
+            escape(a);
+            c = a * b;
+            escape(c);
+        });
+        report("multiply", type, N, ns, 2 * n * n * n, error(c, ref_multiply(to_ref(a), to_ref(b), N)), tolerance<T>(N));
+    }
+
+    {
+        Matrix<T, N, N> d = a;
+        if constexpr (std::is_integral_v<T>)
+            d = unimodular_matrix<T, N>(rng);
+
+        T det{};
+        double ns = ns_per_op([&] {
+            escape(d);
+            det = d.det();
+            escape(det);
+        });
+
+        Ref ref = to_ref(d);
+        report("det", type, N, ns, 2 * n * n * n / 3, error(det, ref_rref(ref, N, N)), tolerance<T>(N));
+    }
+
+    if constexpr (std::is_floating_point_v<T>) {
+        Matrix<T, N, N> inv{};
+        double ns = ns_per_op([&] {
+            escape(a);
+            inv = a.inverted();
+            escape(inv);
+        });
+
+        // [a | I] reduces to [I | a^-1]
+        Ref aug(N * 2 * N);
+        for (unsigned r = 0; r < N; r++)
+            for (unsigned c = 0; c < N; c++) {
+                aug[r * 2 * N + c] = a[r][c];
+                aug[r * 2 * N + N + c] = r == c;
+            }
+        ref_rref(aug, N, 2 * N);
+        Ref ref(N * N);
+        for (unsigned r = 0; r < N; r++)
+            for (unsigned c = 0; c < N; c++)
+                ref[r * N + c] = aug[r * 2 * N + N + c];
+
+        report("invert", type, N, ns, 2 * n * n * n, error(inv, ref), tolerance<T>(N));
+    }
+
+    if constexpr (std::is_floating_point_v<T> && N <= BATCH_MAX_N)
+        bench_batch<T, N>(rng);
+
+    if constexpr (std::is_floating_point_v<T>) {
+        // a system with one right-hand side, which is what rref() is mostly used for
+        Matrix<T, N, N + 1> sys = random_matrix<T, N, N + 1>(rng);
+        Matrix<T, N, N + 1> red{};
+        double ns = ns_per_op([&] {
+            escape(sys);
+            red = sys.rrefed();
+            escape(red);
+        });
+
+        Ref ref = to_ref(sys);
+        ref_rref(ref, N, N + 1);
+        report("rref", type, N, ns, n * n * n, error(red, ref), tolerance<T>(N));
+    }
+
+    {
+        Matrix<T, N, N> t{};
+        double ns = ns_per_op([&] {
+            escape(a);
+            t = transpose(a);
+            escape(t);
+        });
+
+        Ref ref(N * N);
+        for (unsigned r = 0; r < N; r++)
+            for (unsigned c = 0; c < N; c++)
+                ref[c * N + r] = a[r][c];
+        report("transpose", type, N, ns, 0, error(t, ref), 0);
+    }
+
+    {
+        Vector<T, N> x = random_matrix<T, N, 1>(rng);
+        Vector<T, N> y = random_matrix<T, N, 1>(rng);
+        T d{};
+        double ns = ns_per_op([&] {
+            escape(x);
+            d = dot(x, y);
+            escape(d);
+        });
+
+        long double ref = 0;
+        for (unsigned i = 0; i < N; i++)
+            ref += static_cast<long double>(x[i][0]) * y[i][0];
+        report("dot", type, N, ns, 2 * n, error(d, ref), tolerance<T>(N));
+    }
+}
+
+template<typename T, unsigned... N>
+static void bench_type(std::integer_sequence<unsigned, N...>) {
+    (bench_size<T, N>(), ...);
+}
+
+// Everything the kernels compute on the constant-evaluation path, which multiply() and the
+// expression templates take instead of the blocked/vectorized one.
+struct ConstexprResults {
+    Mat<2, 2> product, accumulated;
+    Mat<2, 3> expression;
+    Mat<3, 2> transposed;
+    Mat<8, 8> big_product;
+    double dot, det;
+    long det_integer;
+    Mat<4, 4> inverse;
+    Vec<4> solution;
+    Mat<3, 3> rref;
+};
+
+struct ConstexprInputs {
+    Mat<2, 3> a;
+    Mat<3, 2> b;
+    Mat<8, 8> c;
+    Mat<4, 4> m;
+    Matrix<long, 4, 4> mi;
+    Mat<3, 3> s;
+};
+
+static constexpr ConstexprInputs constexpr_inputs() {
+    ConstexprInputs in{{{{1, 2, 3}, {4, 5, 6}}},
+                       {{{7, 8}, {9, 10}, {11, 12}}},
+                       {},
+                       {{{2, 1, 1, 0}, {4, 3, 3, 1}, {8, 7, 9, 5}, {6, 7, 9, 8}}},
+                       {{{2, 1, 1, 0}, {4, 3, 3, 1}, {8, 7, 9, 5}, {6, 7, 9, 8}}},
+                       {{{1, 2, 3}, {2, 4, 6}, {1, 0, 1}}}};
+    for (unsigned r = 0; r < 8; r++)
+        for (unsigned c = 0; c < 8; c++)
+            in.c[r][c] = static_cast<double>((r * 5 + c * 3) % 7) - 3;
+    return in;
+}
+
+static constexpr ConstexprResults constexpr_ops(const ConstexprInputs &in) {
+    ConstexprResults ret{};
+    ret.product = in.a * in.b;
+    ret.accumulated = ret.product;
+    ret.accumulated += in.a * in.b;
+    ret.expression = in.a + in.a * 2.0 - transpose(in.b);
+    ret.transposed = in.a.transposed();
+    ret.big_product = in.c * in.c;
+    ret.dot = dot(Vec<3>{{{in.a[0][0]}, {in.a[0][1]}, {in.a[0][2]}}}, Matrix<double, 1, 3>{{{in.a[1][0], in.a[1][1], in.a[1][2]}}});
+    ret.det = in.m.det();
+    ret.det_integer = in.mi.det();
+    ret.inverse = in.m.inverted();
+    ret.solution = in.m.solve(Vec<4>{{{7}, {23}, {69}, {79}}});// m * (1, 2, 3, 4)
+    ret.rref = in.s.rrefed();
+    return ret;
+}
+
+static void check_constexpr(const char *op, const char *type, double err) {
+    bool ok = err <= 1e-12;
+    all_ok = all_ok && ok;
+    std::printf("%-10s %-7s %12.3g %s\n", op, type, err, ok ? "ok" : "FAIL");
+}
+
+// Compares every result of constexpr_ops() evaluated at compile time against the same call
+// at run time, on inputs the optimizer cannot see through.
+static void constexpr_checks() {
+    constexpr ConstexprResults at_compile = constexpr_ops(constexpr_inputs());
+    ConstexprInputs in = constexpr_inputs();
+    escape(in);
+    ConstexprResults at_run = constexpr_ops(in);
+    escape(at_run);
+
+    std::printf("\n%-10s %-7s %12s %s\n", "constexpr", "type", "rel. error", "check");
+    check_constexpr("multiply", "double", error(at_compile.product, to_ref(at_run.product)));
+    check_constexpr("+=", "double", error(at_compile.accumulated, to_ref(at_run.accumulated)));
+    check_constexpr("expression", "double", error(at_compile.expression, to_ref(at_run.expression)));
+    check_constexpr("transpose", "double", error(at_compile.transposed, to_ref(at_run.transposed)));
+    check_constexpr("multiply8", "double", error(at_compile.big_product, to_ref(at_run.big_product)));
+    check_constexpr("dot", "double", error(at_compile.dot, at_run.dot));
+    check_constexpr("det", "double", error(at_compile.det, at_run.det));
+    check_constexpr("det", "long", error(at_compile.det_integer, at_run.det_integer));
+    check_constexpr("invert", "double", error(at_compile.inverse, to_ref(at_run.inverse)));
+    check_constexpr("solve", "double", error(at_compile.solution, to_ref(at_run.solution)));
+    check_constexpr("rref", "double", error(at_compile.rref, to_ref(at_run.rref)));
+}
+
+// CG stops at this relative residual. The grids below have condition numbers under 1600, so
+// the error of the solution stays under 1600 times that.
+constexpr double CG_TOLERANCE = 1e-12;
+constexpr double CG_MAX_ERROR = 1e4 * CG_TOLERANCE;
+
+// An m x m grid Laplacian with random edge weights plus a small shift, which makes it
+// symmetric positive definite. It comes as a finite element code would assemble it: every
+// edge adds its 2x2 block, so most entries are given several times.
+static std::vector<SparseMatrix<double>::Entry> grid_entries(std::size_t m, std::mt19937 &rng) {
+    std::uniform_real_distribution<double> weight{0.5, 2.0};
+    std::vector<SparseMatrix<double>::Entry> ret;
+    auto edge = [&](std::size_t i, std::size_t j) {
+        double w = weight(rng);
+        ret.push_back({i, i, w});
+        ret.push_back({j, j, w});
+        ret.push_back({i, j, -w});
+        ret.push_back({j, i, -w});
+    };
+
+    for (std::size_t r = 0; r < m; r++)
+        for (std::size_t c = 0; c < m; c++) {
+            std::size_t i = r * m + c;
+            ret.push_back({i, i, 0.01});
+            if (c + 1 < m)
+                edge(i, i + 1);
+            if (r + 1 < m)
+                edge(i, i + m);
+        }
+    std::shuffle(ret.begin(), ret.end(), rng);
+    return ret;
+}
+
+static void report_sparse(const char *op, std::size_t n, const char *iterations, double residual, double err, bool ok) {
+    all_ok = all_ok && ok;
+    std::printf("%-10s %6zu %10s %12.3g %12.3g %s\n", op, n, iterations, residual, err, ok ? "ok" : "FAIL");
+}
+
+// Checks a CG solution x of a * x = b by its residual, recomputed through the dense matrix,
+// and against the solution DynMatrix::solve() finds.
+static void check_cg(const char *op, const SolveResult<double> &res, const DynMatrix<double> &a,
+                     const std::vector<double> &b, const std::vector<double> &ax, const std::vector<double> &x) {
+    long double r2 = 0, b2 = 0;
+    for (std::size_t i = 0; i < b.size(); i++) {
+        r2 += static_cast<long double>(b[i] - ax[i]) * (b[i] - ax[i]);
+        b2 += static_cast<long double>(b[i]) * b[i];
+    }
+    double residual = static_cast<double>(std::sqrt(r2 / b2));
+
+    std::vector<double> ref = a.solve(b);
+    long double diff = 0, scale = 0;
+    for (std::size_t i = 0; i < x.size(); i++) {
+        diff = std::max<long double>(diff, std::fabs(x[i] - ref[i]));
+        scale = std::max<long double>(scale, std::fabs(ref[i]));
+    }
+    double err = static_cast<double>(diff / scale);
+
+    char iterations[32];
+    std::snprintf(iterations, sizeof(iterations), "%zu", res.iterations);
+    // the recursively updated residual CG stops on drifts a little from the true one
+    bool ok = res.converged && residual <= 10 * CG_TOLERANCE && err <= CG_MAX_ERROR;
+    report_sparse(op, b.size(), iterations, residual, err, ok);
+}
+
+// conjugate_gradient() through each of its overloads, on systems from triplets and from a
+// dense matrix, plus the ways it refuses or gives up.
+static void sparse_checks() {
+    std::mt19937 rng{35};
+    std::normal_distribution<double> dist;
+    std::printf("\n%-10s %6s %10s %12s %12s %s\n", "cg", "n", "iterations", "rel. resid.", "rel. error", "check");
+
+    {
+        // triplets, std::vector, and the default iteration limit
+        SparseMatrix<double> a{1024, 1024, grid_entries(32, rng)};
+        DynMatrix<double> dense = a.to_dense();
+        std::vector<double> b(1024), x;
+        for (double &v: b)
+            v = dist(rng);
+
+        SolveResult<double> res = conjugate_gradient(a, b, x, CG_TOLERANCE);
+        check_cg("triplets", res, dense, b, dense * x, x);
+    }
+
+    {
+        // a dense matrix, raw pointers; the CSR form must match the one built from triplets
+        std::vector<SparseMatrix<double>::Entry> entries = grid_entries(16, rng);
+        SparseMatrix<double> from_entries{256, 256, entries};
+        DynMatrix<double> dense{256, 256};
+        for (const auto &e: entries)
+            dense[e.row][e.col] += e.value;
+
+        SparseMatrix<double> a{dense};
+        bool same = a.row_begin == from_entries.row_begin && a.col_index == from_entries.col_index;
+        for (std::size_t k = 0; same && k < a.nonzeros(); k++)
+            same = std::fabs(a.values[k] - from_entries.values[k]) <= 1e-15 * std::fabs(from_entries.values[k]);
+        report_sparse("from dense", 256, "-", 0, 0, same);
+
+        std::vector<double> b(256), x(256, 0.0);
+        for (double &v: b)
+            v = dist(rng);
+        SolveResult<double> res = conjugate_gradient(a, b.data(), x.data(), CG_TOLERANCE);
+        check_cg("pointers", res, dense, b, a * x, x);
+    }
+
+    {
+        // Vector, with the residual through DynMatrix * Vector
+        SparseMatrix<double> a{64, 64, grid_entries(8, rng)};
+        DynMatrix<double> dense = a.to_dense();
+        Vector<double, 64> b{}, x{};
+        for (unsigned i = 0; i < 64; i++)
+            b[i][0] = dist(rng);
+
+        SolveResult<double> res = conjugate_gradient(a, b, x, CG_TOLERANCE);
+        Vector<double, 64> ax = dense * x;
+        std::vector<double> bv(64), xv(64), axv(64);
+        for (unsigned i = 0; i < 64; i++) {
+            bv[i] = b[i][0];
+            xv[i] = x[i][0];
+            axv[i] = ax[i][0];
+        }
+        check_cg("Vector", res, dense, bv, axv, xv);
+    }
+
+    {
+        bool threw = false;
+        try {
+            std::vector<double> x;
+            conjugate_gradient(SparseMatrix<double>{3, 4, {{0, 0, 1}}}, std::vector<double>(3, 1.0), x);
+        } catch (const std::invalid_argument &) {
+            threw = true;
+        }
+        report_sparse("non-square", 3, "-", 0, 0, threw);
+    }
+
+    {
+        // the first search direction already has p * A * p < 0: CG must stop before any step
+        SparseMatrix<double> a{2, 2, {{0, 0, 1}, {1, 1, -1}}};
+        std::vector<double> b{1, 2}, x{0, 0};
+        SolveResult<double> res = conjugate_gradient(a, b, x);
+        report_sparse("indefinite", 2, "0", res.residual, 0, res.iterations == 0 && !res.converged && x[0] == 0 && x[1] == 0);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1)
+        min_secs = std::max(0.1, std::atof(argv[1])) * 1e-3;
+
+    std::printf("%-10s %-7s %4s %12s %9s %12s %s\n", "op", "type", "n", "ns/op", "GFLOP/s", "rel. error", "check");
+    bench_type<float>(Sizes{});
+    bench_type<double>(Sizes{});
+    bench_type<int>(Sizes{});
+    constexpr_checks();
+    sparse_checks();
+
+    if (!all_ok)
+        std::printf("some results are outside tolerance\n");
+    return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "lingalg/parallel.hpp"
+
+// Scaling of the parallel lingalg operations across thread counts and sizes. Every result is
+// compared bit for bit against the single-threaded one, and the exit code is non-zero if any
+// differs.
+//
+// usage: LingalgParallelBench [max threads]
+
+static DynMatrix<double> random_matrix(std::size_t rows, std::size_t cols, unsigned seed) {
+    DynMatrix<double> ret{rows, cols};
+    for (std::size_t r = 0; r < rows; r++)
+        for (std::size_t c = 0; c < cols; c++)
+            ret[r][c] = std::sin(seed * 12.9898 + r * 78.233 + c * 37.719) + (r == c ? 4.0 : 0.0);
+    return ret;
+}
+
+static bool identical(const DynMatrix<double> &a, const DynMatrix<double> &b) {
+    if (a.rows() != b.rows() || a.cols() != b.cols())
+        return false;
+    for (std::size_t r = 0; r < a.rows(); r++)
+        if (std::memcmp(a[r], b[r], a.cols() * sizeof(double)) != 0)
+            return false;
+    return true;
+}
+
+// best of `reps` runs, in seconds
+static double time_best(int reps, const std::function<void()> &f) {
+    double best = 1e300;
+    for (int i = 0; i < reps; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+struct Op {
+    const char *name;
+    double flops;// per run, in units of n^3; 0 for bandwidth-bound ops
+    std::function<DynMatrix<double>(const Parallel &, const DynMatrix<double> &, const DynMatrix<double> &)> run;
+};
+
+int main(int argc, char **argv) {
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1)
+        max_threads = static_cast<unsigned>(std::max(1, std::atoi(argv[1])));
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    const std::size_t sizes[] = {64, 128, 256, 512, 1024};
+
+    std::vector<Op> ops = {
+            {"multiply", 2.0, [](const Parallel &par, const DynMatrix<double> &a, const DynMatrix<double> &b) { return multiply(par, a, b); }},
+            {"solve", 2.0 / 3.0 + 2.0, [](const Parallel &par, const DynMatrix<double> &a, const DynMatrix<double> &b) { return solve(par, a, b); }},
+            {"transpose", 0, [](const Parallel &par, const DynMatrix<double> &a, const DynMatrix<double> &) { return transposed(par, a); }},
+            {"add", 0, [](const Parallel &par, const DynMatrix<double> &a, const DynMatrix<double> &b) { return add(par, a, b); }},
+    };
+
+    bool all_identical = true;
+    std::printf("%-10s %6s %8s %12s %10s %8s %s\n", "op", "n", "threads", "ms", "GFLOP/s", "speedup", "identical");
+    for (const Op &op: ops) {
+        for (std::size_t n: sizes) {
+            DynMatrix<double> a = random_matrix(n, n, 1);
+            DynMatrix<double> b = random_matrix(n, n, 2);
+            int reps = n <= 256 ? 10 : 3;
+
+            DynMatrix<double> reference;
+            double base = 0;
+            for (unsigned threads: thread_counts) {
+                ThreadPool pool{threads};
+                Parallel par{&pool};
+
+                DynMatrix<double> result;
+                double secs = time_best(reps, [&] { result = op.run(par, a, b); });
+                if (threads == thread_counts.front()) {
+                    reference = result;
+                    base = secs;
+                }
+
+                bool same = identical(result, reference);
+                all_identical = all_identical && same;
+
+                char gflops[32] = "-";
+                if (op.flops > 0)
+                    std::snprintf(gflops, sizeof(gflops), "%.2f", op.flops * static_cast<double>(n) * n * n / secs * 1e-9);
+
+                std::printf("%-10s %6zu %8u %12.3f %10s %8.2f %s\n", op.name, n, threads, secs * 1e3, gflops,
+                            base / secs, same ? "yes" : "NO");
+            }
+        }
+    }
+
+    if (!all_identical)
+        std::printf("some results differ from the single-threaded ones\n");
+    return all_identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -28,7 +28,76 @@
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Target/TargetMachine.h"
 
+// Compiles every function in `path` into the JIT and runs `main` if there is one
+int run_source(const char *path) {
+    std::ifstream t(path);
+    std::stringstream buffer;
+    buffer << t.rdbuf();
+
+    std::string str = buffer.str();
+
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+    LLVMInitializeNativeAsmParser();
+
+    JITSession session;
+    Parser parse{str, session.context(), &session};
+    parse.scan_lines();
+    parse.ind = 0;
+
+    parse.parse_program();
+    if (parse.diag.has_errors()) {
+        parse.diag.print(std::cerr);
+        return 1;
+    }
+
+    auto entry = session.functions.find("main");
+    if (entry == session.functions.end())
+        return 0;
+
+    Type *signature = entry->second.signature;
+    if (signature->num_params != 0) {
+        std::cerr << "main must not take any parameters\n";
+        return 1;
+    }
+
+    std::cout << "===== [Compilation Finished! JIT Now Running...] =====\n";
+
+    Type *ret = signature->element;
+    if (ret->is_void())
+        session.get<void()>("main")();
+    else if (ret == session.types.of<float64_t>())
+        std::cout << "main returned " << session.get<float64_t()>("main")() << '\n';
+    else if (ret == session.types.of<float32_t>())
+        std::cout << "main returned " << session.get<float32_t()>("main")() << '\n';
+    else if (ret == session.types.of<bool>())
+        std::cout << "main returned " << std::boolalpha << session.get<bool()>("main")() << '\n';
+    else if (ret == session.types.of<int64_t>())
+        std::cout << "main returned " << session.get<int64_t()>("main")() << '\n';
+    else if (ret == session.types.of<int32_t>())
+        std::cout << "main returned " << session.get<int32_t()>("main")() << '\n';
+    else if (ret == session.types.of<int16_t>())
+        std::cout << "main returned " << session.get<int16_t()>("main")() << '\n';
+    else if (ret == session.types.of<int8_t>())
+        std::cout << "main returned " << +session.get<int8_t()>("main")() << '\n';
+    else if (ret == session.types.of<uint64_t>())
+        std::cout << "main returned " << session.get<uint64_t()>("main")() << '\n';
+    else if (ret == session.types.of<uint32_t>())
+        std::cout << "main returned " << session.get<uint32_t()>("main")() << '\n';
+    else if (ret == session.types.of<uint16_t>())
+        std::cout << "main returned " << session.get<uint16_t()>("main")() << '\n';
+    else if (ret == session.types.of<uint8_t>())
+        std::cout << "main returned " << +session.get<uint8_t()>("main")() << '\n';
+    else
+        std::cout << "main returned a " << ret->to_string() << '\n';
+
+    return 0;
+}
+
 int main(int argc, char **argv) {
+    if (argc > 1)
+        return run_source(argv[1]);
+
     std::ifstream t("bf.txt");
     std::stringstream buffer;
     buffer << t.rdbuf();
@@ -74,9 +143,13 @@ int main(int argc, char **argv) {
 
     parse.scan_lines();
     parse.ind = 0;
-//    parse.shunting_yard();
     parse.brainfuck();
 
+    if (parse.diag.has_errors()) {
+        parse.diag.print(std::cerr);
+        return 1;
+    }
+
 
     auto filename = "output.o";
     std::error_code ec;
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "mnk.hpp"
+#include "tic_tac_toe.hpp"
+
+// Scaling of the parallel game-tree searches across thread counts: TicTacToe::gen_best_moves()
+// on every reachable position, t3_evaluate() on a million of them, and fixed-depth MnkSearch
+// runs on bigger boards. Every result is compared against the single-threaded one, and the
+// exit code is non-zero if any differs.
+//
+// usage: MnkBench [max threads]
+
+struct Run {
+    double seconds;
+    uint64_t nodes;// 0 where not counted
+    std::vector<long> result;
+};
+
+struct Case {
+    const char *name;
+    std::function<Run(ThreadPool &)> run;
+};
+
+// every position TicTacToe can reach with the game still on
+static std::vector<TicTacToe> reachable() {
+    T3Batch batch = t3_reachable();
+    std::vector<TicTacToe> ret(batch.size());
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        ret[i].x = batch.x[i];
+        ret[i].o = batch.o[i];
+        ret[i].is_x_turn = batch.x_turn[i];
+        ret[i].num_moves = __builtin_popcount(static_cast<unsigned>(batch.x[i] | batch.o[i]));
+    }
+    return ret;
+}
+
+// the reachable positions, `copies` times over
+static T3Batch repeated(std::size_t copies) {
+    T3Batch once = t3_reachable(), ret;
+    for (std::size_t c = 0; c < copies; c++)
+        for (std::size_t i = 0; i < once.size(); i++)
+            ret.push_back(once.x[i], once.o[i], once.x_turn[i]);
+    return ret;
+}
+
+template <uint32_t M, uint32_t N, uint32_t K>
+static Case mnk_case(const char *name, uint32_t depth, uint32_t reach, std::vector<uint32_t> opening) {
+    return {name, [=](ThreadPool &pool) {
+                MnkGame<M, N, K> game;
+                for (uint32_t sq: opening)
+                    game.play(sq);
+
+                MnkSearch<M, N, K> search;
+                MnkLimits limits;
+                limits.max_depth = depth;
+                limits.reach = reach;
+                limits.pool = &pool;
+                MnkResult r = search.search(game, limits);
+                return Run{r.seconds, r.nodes, {r.square, r.score, static_cast<long>(r.depth)}};
+            }};
+}
+
+int main(int argc, char **argv) {
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1)
+        max_threads = static_cast<unsigned>(std::max(1, std::atoi(argv[1])));
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::vector<TicTacToe> positions = reachable();
+    T3Batch batch = repeated(1000000 / positions.size());
+
+    std::vector<Case> cases = {
+            {"3,3,3 all", [&](ThreadPool &pool) {
+                 Run ret{0, 0, {}};
+                 auto start = std::chrono::steady_clock::now();
+                 for (TicTacToe game: positions) {
+                     game.pool = &pool;
+                     game.gen_best_moves();
+                     ret.result.insert(ret.result.end(), game.scores, game.scores + 9);
+                 }
+                 ret.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                 return ret;
+             }},
+            {"3,3,3 soa", [&](ThreadPool &pool) {
+                 auto start = std::chrono::steady_clock::now();
+                 t3_evaluate(batch, &pool);
+                 Run ret{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 0, {}};
+                 ret.result.assign(batch.scores.begin(), batch.scores.end());
+                 return ret;
+             }},
+            mnk_case<4, 4, 4>("4,4,4", 10, 0, {}),
+            mnk_case<5, 5, 4>("5,5,4", 8, 0, {12}),
+            mnk_case<7, 7, 5>("7,7,5", 7, 2, {24, 25}),
+            mnk_case<15, 15, 5>("15,15,5", 6, 2, {112, 113, 127}),
+    };
+
+    bool all_identical = true;
+    std::printf("%-10s %8s %12s %10s %8s %s\n", "case", "threads", "ms", "knodes/s", "speedup", "identical");
+    for (const Case &c: cases) {
+        Run reference{0, 0, {}};
+        for (unsigned threads: thread_counts) {
+            ThreadPool pool{threads};
+            Run run = c.run(pool);
+            if (threads == thread_counts.front())
+                reference = run;
+
+            bool same = run.result == reference.result;
+            all_identical = all_identical && same;
+
+            char rate[32] = "-";
+            if (run.nodes > 0)
+                std::snprintf(rate, sizeof(rate), "%.0f", static_cast<double>(run.nodes) / run.seconds * 1e-3);
+
+            std::printf("%-10s %8u %12.3f %10s %8.2f %s\n", c.name, threads, run.seconds * 1e3, rate,
+                        reference.seconds / run.seconds, same ? "yes" : "NO");
+        }
+    }
+
+    if (!all_identical)
+        std::printf("some results differ from the single-threaded ones\n");
+    return all_identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "compiler/parse.hpp"
+
+#include "llvm/Support/TargetSelect.h"
+
+// A broken top-level line must not take the next declaration down with it: the errors in
+// that declaration are still reported, and nothing is reported about it going missing.
+
+struct Case {
+    const char *name;
+    const char *source;
+    std::vector<std::string> expected;// every diagnostic, in order
+};
+
+static std::vector<std::string> diagnose(const std::string &source) {
+    JITSession session;
+    Parser parse{source, session.context(), &session};
+    parse.scan_lines();
+    parse.ind = 0;
+    parse.parse_program();
+
+    std::vector<std::string> ret;
+    for (const Diagnostic &d: parse.diag.list)
+        ret.push_back(d.message);
+    return ret;
+}
+
+int main() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+
+    const char *rest = "n = func(i32 a, i32 a) -> i32 {\n"
+                       "    return a;\n"
+                       "}\n"
+                       "\n"
+                       "main = func() -> i32 {\n"
+                       "    return n(1, 2);\n"
+                       "}\n";
+
+    std::vector<Case> cases = {
+            {"with ';'", "oops = 5;\n", {"Expected 'func' after 'oops ='", "Duplicate parameter 'a'"}},
+            {"without ';'", "oops = 5\n", {"Expected 'func' after 'oops ='", "Duplicate parameter 'a'"}},
+    };
+
+    int failed = 0;
+    for (const Case &c: cases) {
+        std::vector<std::string> got = diagnose(std::string{c.source} + rest);
+        if (got == c.expected)
+            continue;
+
+        failed++;
+        std::printf("FAILED %s, got:\n", c.name);
+        for (const std::string &msg: got)
+            std::printf("    %s\n", msg.c_str());
+    }
+
+    std::printf("%zu cases, %d failed\n", cases.size(), failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}